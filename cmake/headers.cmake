@@ -3,15 +3,36 @@ set(kerneltest_HEADERS
   "include/kerneltest.hpp"
   "include/kerneltest/kerneltest.hpp"
   "include/kerneltest/revision.hpp"
+  "include/kerneltest/v1.0/benchmark.hpp"
+  "include/kerneltest/v1.0/cartesian_product.hpp"
+  "include/kerneltest/v1.0/check_summary.hpp"
   "include/kerneltest/v1.0/child_process.hpp"
+  "include/kerneltest/v1.0/command_line.hpp"
   "include/kerneltest/v1.0/config.hpp"
+  "include/kerneltest/v1.0/cost_profile.hpp"
+  "include/kerneltest/v1.0/covering_array.hpp"
   "include/kerneltest/v1.0/detail/impl/child_process.ipp"
   "include/kerneltest/v1.0/detail/impl/posix/child_process.ipp"
   "include/kerneltest/v1.0/detail/impl/windows/child_process.ipp"
+  "include/kerneltest/v1.0/executor.hpp"
+  "include/kerneltest/v1.0/fork_server.hpp"
+  "include/kerneltest/v1.0/generated_sequence.hpp"
   "include/kerneltest/v1.0/hooks/custom.hpp"
   "include/kerneltest/v1.0/hooks/filesystem_workspace.hpp"
+  "include/kerneltest/v1.0/hooks/heap_accounting.hpp"
+  "include/kerneltest/v1.0/hooks/latency_budget.hpp"
+  "include/kerneltest/v1.0/hooks/performance_counters.hpp"
   "include/kerneltest/v1.0/kerneltest.hpp"
+  "include/kerneltest/v1.0/log_capture.hpp"
+  "include/kerneltest/v1.0/parameter_hash.hpp"
   "include/kerneltest/v1.0/permute_parameters.hpp"
+  "include/kerneltest/v1.0/recorded_outcome.hpp"
+  "include/kerneltest/v1.0/result_cache.hpp"
+  "include/kerneltest/v1.0/shard.hpp"
+  "include/kerneltest/v1.0/shared_file.hpp"
+  "include/kerneltest/v1.0/signal_recovery.hpp"
   "include/kerneltest/v1.0/test_kernel.hpp"
+  "include/kerneltest/v1.0/topology.hpp"
+  "include/kerneltest/v1.0/watchdog.hpp"
   "include/kerneltest/version.hpp"
 )
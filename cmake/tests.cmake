@@ -2,7 +2,27 @@
 set(kerneltest_TESTS
   "test/auto_permute_test_kernel1.hpp"
   "test/auto_permute_test_kernel2.hpp"
+  "test/benchmark_statistics.cpp"
   "test/coverage_main.cpp"
+  "test/fail_fast.cpp"
+  "test/heap_accounting_performance_counters.cpp"
+  "test/hook_sessions.cpp"
+  "test/isolated_crash.cpp"
+  "test/latency_budget.cpp"
+  "test/list_pretty_print.cpp"
+  "test/list_sequence.cpp"
+  "test/log_capture.cpp"
+  "test/parameter_hash.cpp"
+  "test/performance_counters_kernel_events.cpp"
+  "test/result_cache_collisions.cpp"
+  "test/run_and_check_summary.cpp"
+  "test/signal_recovery.cpp"
+  "test/timeout.cpp"
+  "test/worker_affinity.cpp"
+  "test/workspace_clone.cpp"
+  "test/workspace_directory_fd.cpp"
+  "test/workspace_reaper.cpp"
+  "test/workspace_recycle.cpp"
 )
 # DO NOT EDIT, GENERATED BY SCRIPT
 set(kerneltest_COMPILE_TESTS
@@ -0,0 +1,264 @@
+/* Latency measurement of repeated permutations
+(C) 2026 agent <agent@local>
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#include "config.hpp"
+
+#ifndef KERNELTEST_BENCHMARK_HPP
+#define KERNELTEST_BENCHMARK_HPP
+
+#include "recorded_outcome.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define KERNELTEST_BENCHMARK_TSC 1
+#elif(defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define KERNELTEST_BENCHMARK_TSC 1
+#endif
+
+KERNELTEST_V1_NAMESPACE_BEGIN
+
+//! \brief Options affecting how `parameter_permuter::benchmark()` repeats each permutation
+struct benchmark_options
+{
+  //! The number of untimed executions of each permutation before measuring it
+  size_t warmup{1};
+  //! The least number of timed executions of each permutation
+  size_t min_repetitions{10};
+  //! The most number of timed executions of each permutation
+  size_t max_repetitions{10000};
+  /*! Stop repeating a permutation once the 95% confidence interval of its mean latency is within this fraction
+  of the mean either side. Zero means always execute `max_repetitions` times.
+  */
+  double confidence{0.01};
+  /*! Stop repeating a permutation once this long has passed since its repetitions began, if it has been timed at
+  least `min_repetitions` times. This includes the warmup and the setting up and tearing down of the hooks.
+  */
+  std::chrono::milliseconds max_time{1000};
+};
+
+//! \brief The distribution of the latencies of the timed executions of a permutation, in nanoseconds
+struct latency_statistics
+{
+  size_t samples{0};  //!< The number of timed executions
+  uint64_t min{0};    //!< The fastest execution
+  uint64_t median{0}; //!< The median execution
+  uint64_t p99{0};    //!< The 99th percentile execution
+  uint64_t max{0};    //!< The slowest execution
+  double mean{0};     //!< The mean execution
+  double stddev{0};   //!< The standard deviation of the executions
+};
+
+/*! \brief The outcome of benchmarking a permutation, which can be checked and pretty printed like
+the results of the call operator of `parameter_permuter`.
+*/
+struct benchmark_result
+{
+  //! The outcome of the first execution, which is what gets checked
+  recorded_outcome outcome;
+  //! The latencies of the timed executions. Empty if the permutation failed.
+  latency_statistics latency;
+
+  //! True if the outcome matched what it should have been
+  bool passed() const noexcept { return outcome.passed(); }
+};
+
+//! Returns the printed form of a benchmark result
+inline std::string print(const benchmark_result &v)
+{
+  std::ostringstream s;
+  s << v.outcome.description();
+  if(v.latency.samples > 0)
+    s << " [min " << v.latency.min << " ns, median " << v.latency.median << " ns, p99 " << v.latency.p99 << " ns, max " << v.latency.max << " ns, " << v.latency.samples << " samples]";
+  return s.str();
+}
+//! Prints a benchmark result
+inline std::ostream &operator<<(std::ostream &s, const benchmark_result &v)
+{
+  return s << print(v);
+}
+
+namespace detail
+{
+  template <class T> inline bool check_result(const optional<benchmark_result> &kernel_outcome, const T & /*unused*/) { return kernel_outcome.value().passed(); }
+  template <class T> inline bool compare(const benchmark_result &a, const T & /*unused*/) { return a.passed(); }
+
+  /* A clock cheap enough to read around a kernel of a few nanoseconds. On x86 this is the time stamp
+  counter, calibrated against std::chrono::steady_clock once per process, elsewhere it is the steady clock.
+  The time stamp counter is read between fences, so the CPU can't execute any of the kernel outside of the
+  readings. The cost of reading the clock twice is measured at the same time, and subtracted from every interval.
+  */
+  class benchmark_clock
+  {
+    double _ns_per_tick{1};
+    uint64_t _overhead{0};
+
+    benchmark_clock()
+    {
+#ifdef KERNELTEST_BENCHMARK_TSC
+      const auto begin = std::chrono::steady_clock::now();
+      const uint64_t ticks_begin = start();
+      while(std::chrono::steady_clock::now() - begin < std::chrono::milliseconds(20))
+        ;
+      const uint64_t ticks_end = stop();
+      const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count();
+      if(ticks_end > ticks_begin)
+        _ns_per_tick = static_cast<double>(ns) / static_cast<double>(ticks_end - ticks_begin);
+#endif
+      uint64_t overhead = UINT64_MAX;
+      for(size_t n = 0; n < 1000; n++)
+      {
+        const uint64_t a = start();
+        const uint64_t b = stop();
+        overhead = std::min(overhead, b - a);
+      }
+      _overhead = overhead;
+    }
+
+#ifdef KERNELTEST_BENCHMARK_TSC
+    // Waits for every earlier instruction to complete before any later one starts
+    static void _lfence() noexcept
+    {
+#ifdef _MSC_VER
+      _mm_lfence();
+#else
+      __asm__ __volatile__("lfence" ::: "memory");
+#endif
+    }
+#else
+    static uint64_t _steady_now() noexcept { return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count()); }
+#endif
+
+  public:
+    //! The process wide instance, calibrated on first use
+    static const benchmark_clock &get()
+    {
+      static const benchmark_clock v;
+      return v;
+    }
+    //! The time in ticks before the code being timed, once everything before it has executed
+    static uint64_t start() noexcept
+    {
+#ifdef KERNELTEST_BENCHMARK_TSC
+      _lfence();
+      const uint64_t ret = __rdtsc();
+      _lfence();
+      return ret;
+#else
+      return _steady_now();
+#endif
+    }
+    //! The time in ticks after the code being timed, once all of it has executed
+    static uint64_t stop() noexcept
+    {
+#ifdef KERNELTEST_BENCHMARK_TSC
+      unsigned int aux;
+      const uint64_t ret = __rdtscp(&aux);
+      _lfence();
+      return ret;
+#else
+      return _steady_now();
+#endif
+    }
+    //! The nanoseconds between two readings of the clock, less the cost of reading it
+    uint64_t nanoseconds(uint64_t begin, uint64_t end) const noexcept
+    {
+      const uint64_t ticks = end - begin;
+      return (ticks > _overhead) ? static_cast<uint64_t>(static_cast<double>(ticks - _overhead) * _ns_per_tick) : 0;
+    }
+  };
+
+  // Accumulates timed executions of a permutation, and says when there have been enough. The time
+  // allowed by the options runs from construction, so includes everything done between executions.
+  class latency_sampler
+  {
+    const benchmark_options &_options;
+    std::chrono::steady_clock::time_point _deadline;
+    std::vector<uint64_t> _samples;
+    double _sum{0}, _sum_squares{0};
+
+  public:
+    explicit latency_sampler(const benchmark_options &options)
+        : _options(options)
+        , _deadline(std::chrono::steady_clock::now() + options.max_time)
+    {
+      _samples.reserve(std::min<size_t>(options.max_repetitions, 4096));
+    }
+
+    void add(uint64_t nanoseconds)
+    {
+      _samples.push_back(nanoseconds);
+      _sum += static_cast<double>(nanoseconds);
+      _sum_squares += static_cast<double>(nanoseconds) * static_cast<double>(nanoseconds);
+    }
+
+    // True once the mean is known well enough, or we have run out of repetitions or time
+    bool done() const noexcept
+    {
+      const size_t n = _samples.size();
+      if(n >= _options.max_repetitions)
+        return true;
+      if(n < std::max<size_t>(_options.min_repetitions, 2))
+        return false;
+      if(std::chrono::steady_clock::now() >= _deadline)
+        return true;
+      if(_options.confidence <= 0)
+        return false;
+      const double mean = _sum / static_cast<double>(n);
+      const double variance = std::max(0.0, (_sum_squares - _sum * mean) / static_cast<double>(n - 1));
+      return 1.96 * std::sqrt(variance / static_cast<double>(n)) <= _options.confidence * mean;
+    }
+
+    latency_statistics statistics()
+    {
+      latency_statistics ret;
+      const size_t n = _samples.size();
+      if(n == 0)
+        return ret;
+      std::sort(_samples.begin(), _samples.end());
+      // Nearest rank percentiles
+      auto percentile = [&](double p) { return _samples[std::min(n - 1, static_cast<size_t>(std::ceil(p * static_cast<double>(n))) - 1)]; };
+      ret.samples = n;
+      ret.min = _samples.front();
+      ret.median = percentile(0.5);
+      ret.p99 = percentile(0.99);
+      ret.max = _samples.back();
+      ret.mean = _sum / static_cast<double>(n);
+      ret.stddev = (n > 1) ? std::sqrt(std::max(0.0, (_sum_squares - _sum * ret.mean) / static_cast<double>(n - 1))) : 0;
+      return ret;
+    }
+  };
+}  // namespace detail
+
+KERNELTEST_V1_NAMESPACE_END
+
+#endif
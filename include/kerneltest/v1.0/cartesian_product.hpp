@@ -0,0 +1,175 @@
+/* Compile time cartesian products of parameter values
+(C) 2026 agent <agent@local>
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#include "config.hpp"
+
+#ifndef KERNELTEST_CARTESIAN_PRODUCT_HPP
+#define KERNELTEST_CARTESIAN_PRODUCT_HPP
+
+#include <array>
+#include <type_traits>
+#include <utility>
+
+KERNELTEST_V1_NAMESPACE_BEGIN
+
+/*! \brief A list of the values a kernel parameter of integral or enumeration type `T` can take,
+for use with `cartesian_product()`.
+*/
+template <class T, T... Values> struct value_list
+{
+  //! The type of the kernel parameter
+  using value_type = T;
+  //! The number of values
+  static constexpr size_t size = sizeof...(Values);
+  //! Returns the value at `idx`
+  static constexpr T value(size_t idx)
+  {
+    const T values[sizeof...(Values) + 1] = {Values...};
+    return values[idx];
+  }
+};
+
+namespace detail
+{
+  template <class... Lists> struct cartesian_product_combinations;
+  template <> struct cartesian_product_combinations<>
+  {
+    static constexpr size_t value = 1;
+  };
+  template <class List, class... Lists> struct cartesian_product_combinations<List, Lists...>
+  {
+    static constexpr size_t value = List::size * cartesian_product_combinations<Lists...>::value;
+  };
+
+  // The value of list K in combination idx of the product, where the last list varies fastest
+  template <size_t K, class... Lists> constexpr auto cartesian_product_value(size_t idx)
+  {
+    using list = typename std::tuple_element<K, std::tuple<Lists...>>::type;
+    constexpr size_t sizes[] = {Lists::size...};
+    size_t stride = 1;
+    for(size_t n = K + 1; n < sizeof...(Lists); n++)
+      stride *= sizes[n];
+    return list::value((idx / stride) % list::size);
+  }
+
+  template <class Filter, class... Lists, size_t... Ks> constexpr bool cartesian_product_keeps(size_t idx, std::index_sequence<Ks...>) { return Filter()(cartesian_product_value<Ks, Lists...>(idx)...); }
+
+  // The combinations of the product kept by the filter, found in a single pass
+  template <size_t N> struct cartesian_product_survivors
+  {
+    size_t count{0};
+    size_t idx[N > 0 ? N : 1]{};
+  };
+  template <class Filter, class... Lists> constexpr auto cartesian_product_filter()
+  {
+    cartesian_product_survivors<cartesian_product_combinations<Lists...>::value> ret{};
+    for(size_t idx = 0; idx < cartesian_product_combinations<Lists...>::value; idx++)
+    {
+      if(cartesian_product_keeps<Filter, Lists...>(idx, std::index_sequence_for<Lists...>()))
+        ret.idx[ret.count++] = idx;
+    }
+    return ret;
+  }
+  template <class Filter, class... Lists> constexpr cartesian_product_survivors<cartesian_product_combinations<Lists...>::value> cartesian_product_survivors_v = cartesian_product_filter<Filter, Lists...>();
+
+  struct cartesian_product_keep_all
+  {
+    template <class... Types> constexpr bool operator()(Types &&...) const noexcept { return true; }
+  };
+
+  // The combination of the product at row idx of the table
+  template <class Filter, class... Lists> struct cartesian_product_rows_of
+  {
+    static constexpr size_t size() { return cartesian_product_survivors_v<Filter, Lists...>.count; }
+    static constexpr size_t combination(size_t idx) { return cartesian_product_survivors_v<Filter, Lists...>.idx[idx]; }
+  };
+  template <class... Lists> struct cartesian_product_rows_of<cartesian_product_keep_all, Lists...>
+  {
+    static constexpr size_t size() { return cartesian_product_combinations<Lists...>::value; }
+    static constexpr size_t combination(size_t idx) { return idx; }
+  };
+
+  template <class Outcome, class... Lists, class Expected, class Hooks, size_t... Ks> constexpr auto cartesian_product_row(size_t idx, const Expected &expected, const Hooks &hooks, std::index_sequence<Ks...>)
+  {
+    return std::tuple_cat(std::make_tuple(Outcome(expected(cartesian_product_value<Ks, Lists...>(idx)...)), parameters<typename Lists::value_type...>(cartesian_product_value<Ks, Lists...>(idx)...)), hooks);
+  }
+  template <class Row, class Outcome, class Filter, class... Lists, class Expected, class Hooks, size_t... Is> constexpr std::array<Row, sizeof...(Is)> cartesian_product_rows(const Expected &expected, const Hooks &hooks, std::index_sequence<Is...>)
+  {
+    return {{cartesian_product_row<Outcome, Lists...>(cartesian_product_rows_of<Filter, Lists...>::combination(Is), expected, hooks, std::index_sequence_for<Lists...>())...}};
+  }
+}  // namespace detail
+
+/*! \brief The number of rows of a `filtered_cartesian_product()` of `Lists`, after removing those rejected
+by `Filter`, which may be `void` to keep every combination.
+*/
+template <class Filter, class... Lists> struct cartesian_product_size
+{
+  static constexpr size_t value = detail::cartesian_product_rows_of<typename std::conditional<std::is_void<Filter>::value, detail::cartesian_product_keep_all, Filter>::type, Lists...>::size();
+};
+
+/*! \brief Returns a parameter table of every combination of the values in the `value_list`s `Lists`
+which `Filter` keeps, suitable for `st_permute_parameters()` and `mt_permute_parameters()`.
+
+Each row is `parameters<Outcome, parameters<typename Lists::value_type...>, HookParameters...>`.
+The expected outcome of each combination is `expected(values...)`, and every row gets a copy
+of `hook_parameters`. Combinations are in the order of nested loops over `Lists` with the last
+list varying fastest.
+
+`Filter` is a default constructible type whose `constexpr bool operator()(values...)` returns
+false for combinations which are not valid to test. It is evaluated once per combination at
+compile time. If `expected` is constexpr and the row types are literal types, the whole table
+can be `constexpr`, otherwise it is built without any dynamic memory allocation at runtime.
+\tparam Outcome The type of the outcome of the test kernel.
+\tparam Filter The type of the filter, or `void` to keep every combination.
+\tparam Lists The `value_list` of each kernel parameter.
+*/
+template <class Outcome, class Filter, class... Lists, class Expected, class... HookParameters> constexpr auto filtered_cartesian_product(const Expected &expected, HookParameters &&... hook_parameters)
+{
+  using filter = typename std::conditional<std::is_void<Filter>::value, detail::cartesian_product_keep_all, Filter>::type;
+  using row_type = parameters<Outcome, parameters<typename Lists::value_type...>, typename std::decay<HookParameters>::type...>;
+  return detail::cartesian_product_rows<row_type, Outcome, filter, Lists...>(expected, std::make_tuple(std::forward<HookParameters>(hook_parameters)...), std::make_index_sequence<cartesian_product_size<filter, Lists...>::value>());
+}
+
+/*! \brief Returns a parameter table of every combination of the values in the `value_list`s `Lists`.
+Equivalent to `filtered_cartesian_product<Outcome, void, Lists...>()`.
+
+For example:
+\code
+struct valid_open
+{
+  constexpr bool operator()(mode m, creation c) const { return m != mode::read || c == creation::open_existing; }
+};
+static const auto table = filtered_cartesian_product<result<void>, valid_open, value_list<mode, mode::read, mode::write>, value_list<creation, creation::open_existing, creation::if_needed>>(
+[](mode, creation) -> result<void> { return success(); }, hooks::filesystem_setup_parameters{"existing1"}, hooks::filesystem_comparison_structure_parameters{"existing1"});
+auto permuter = mt_permute_parameters(table, ...);
+\endcode
+*/
+template <class Outcome, class... Lists, class Expected, class... HookParameters> constexpr auto cartesian_product(const Expected &expected, HookParameters &&... hook_parameters)
+{
+  return filtered_cartesian_product<Outcome, void, Lists...>(expected, std::forward<HookParameters>(hook_parameters)...);
+}
+
+KERNELTEST_V1_NAMESPACE_END
+
+#endif
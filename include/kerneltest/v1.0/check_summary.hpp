@@ -0,0 +1,107 @@
+/* Compact record of which permutations passed
+(C) 2026 agent <agent@local>
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#include "config.hpp"
+
+#ifndef KERNELTEST_CHECK_SUMMARY_HPP
+#define KERNELTEST_CHECK_SUMMARY_HPP
+
+#include "recorded_outcome.hpp"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+KERNELTEST_V1_NAMESPACE_BEGIN
+
+/*! \brief What `parameter_permuter::run_and_check()` keeps of each permutation once its outcome has been
+checked and destroyed: one bit for whether it ran, one bit for whether it passed, and the recorded outcome
+of each permutation which failed, which are expected to be few.
+*/
+class check_summary
+{
+  std::vector<uint64_t> _ran, _passed;
+  std::unordered_map<size_t, recorded_outcome> _failures;
+  size_t _size{0}, _ran_count{0}, _passed_count{0};
+  bool _ok{true};
+
+  static bool _bit(const std::vector<uint64_t> &v, size_t idx) noexcept { return ((v[idx / 64] >> (idx % 64)) & 1) != 0; }
+  static void _set(std::vector<uint64_t> &v, size_t idx) noexcept { v[idx / 64] |= uint64_t(1) << (idx % 64); }
+
+public:
+  //! Constructs an instance for `size` permutations, none of which have run
+  explicit check_summary(size_t size = 0)
+      : _ran((size + 63) / 64)
+      , _passed((size + 63) / 64)
+      , _size(size)
+  {
+  }
+
+  //! Records that the permutation at `idx` passed
+  void record_pass(size_t idx)
+  {
+    if(!_bit(_ran, idx))
+      _ran_count++;
+    _set(_ran, idx);
+    _set(_passed, idx);
+    _passed_count++;
+  }
+  //! Records that the permutation at `idx` failed with `outcome`
+  void record_failure(size_t idx, recorded_outcome outcome)
+  {
+    if(!_bit(_ran, idx))
+      _ran_count++;
+    _set(_ran, idx);
+    _failures[idx] = std::move(outcome);
+  }
+  //! Records that a callback returned false
+  void record_not_ok() noexcept { _ok = false; }
+
+  //! The number of permutations
+  size_t size() const noexcept { return _size; }
+  //! True if the permutation at `idx` ran
+  bool ran(size_t idx) const noexcept { return _bit(_ran, idx); }
+  //! True if the permutation at `idx` ran and produced its expected outcome
+  bool passed(size_t idx) const noexcept { return _bit(_passed, idx); }
+  //! The recorded outcome of the permutation at `idx` if it failed, otherwise null
+  const recorded_outcome *failure(size_t idx) const
+  {
+    auto it = _failures.find(idx);
+    return (it != _failures.end()) ? &it->second : nullptr;
+  }
+  //! The number of permutations which ran
+  size_t ran_count() const noexcept { return _ran_count; }
+  //! The number of permutations which passed
+  size_t passed_count() const noexcept { return _passed_count; }
+  //! The number of permutations which failed
+  size_t failed_count() const noexcept { return _failures.size(); }
+  //! True if every permutation which ran passed
+  bool all_passed() const noexcept { return _failures.empty(); }
+  //! True if every callback returned true, which is what `parameter_permuter::check()` would have returned
+  bool ok() const noexcept { return _ok; }
+};
+
+KERNELTEST_V1_NAMESPACE_END
+
+#endif
@@ -0,0 +1,107 @@
+/* Command line options
+(C) 2026 agent <agent@local>
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#include "config.hpp"
+
+#ifndef KERNELTEST_COMMAND_LINE_HPP
+#define KERNELTEST_COMMAND_LINE_HPP
+
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#ifdef __APPLE__
+#include <crt_externs.h>
+#endif
+
+KERNELTEST_V1_NAMESPACE_BEGIN
+
+namespace detail
+{
+  // The test runner owns main(), so fetch the arguments of the process from the system
+  inline const std::vector<std::string> &process_arguments()
+  {
+    static const std::vector<std::string> args = [] {
+      std::vector<std::string> ret;
+#if defined(_WIN32)
+      for(int n = 1; n < __argc; n++)
+      {
+        if(__argv != nullptr)
+          ret.emplace_back(__argv[n]);
+      }
+#elif defined(__APPLE__)
+      for(int n = 1; n < *_NSGetArgc(); n++)
+        ret.emplace_back((*_NSGetArgv())[n]);
+#else
+      std::ifstream s("/proc/self/cmdline", std::ios::binary);
+      std::string arg;
+      bool first = true;
+      while(std::getline(s, arg, '\0'))
+      {
+        if(!first)
+          ret.push_back(std::move(arg));
+        first = false;
+      }
+#endif
+      return ret;
+    }();
+    return args;
+  }
+}  // namespace detail
+
+/*! \brief Returns the value of the option `--kerneltest-name=value` from the command line of the process,
+or if not present, of the environment variable `KERNELTEST_NAME` where `NAME` is `name` upper cased with dashes
+replaced by underscores. An option present without a value returns an empty string.
+*/
+inline optional<std::string> command_line_option(const char *name)
+{
+  const std::string option = std::string("--kerneltest-") + name;
+  for(const auto &i : detail::process_arguments())
+  {
+    if(i == option)
+      return std::string();
+    if(i.size() > option.size() && i.compare(0, option.size(), option) == 0 && i[option.size()] == '=')
+      return i.substr(option.size() + 1);
+  }
+  std::string envkey("KERNELTEST_");
+  for(const char *p = name; *p != 0; p++)
+    envkey.push_back((*p == '-') ? '_' : static_cast<char>(toupper(static_cast<unsigned char>(*p))));
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4996)  // Stupid deprecation warning
+#endif
+  auto env = getenv(envkey.c_str());
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+  if(env != nullptr)
+    return std::string(env);
+  return {};
+}
+
+KERNELTEST_V1_NAMESPACE_END
+
+#endif
@@ -207,16 +207,44 @@ KERNELTEST_V1_NAMESPACE_END
 #if !defined(KERNELTEST_COUT) && !defined(KERNELTEST_CERR)
 #include <iostream>
 #endif
+#include <ostream>
 
 KERNELTEST_V1_NAMESPACE_BEGIN
 
+namespace detail
+{
+  //! If set, where `KERNELTEST_COUT` and `KERNELTEST_CERR` write on the calling thread (see `log_capture_mode`)
+  inline std::ostream *&log_capture() noexcept
+  {
+    static QUICKCPPLIB_THREAD_LOCAL std::ostream *v;
+    return v;
+  }
+  //! Returns the stream the calling thread should write to instead of s
+  inline std::ostream &log_stream(std::ostream &s) noexcept
+  {
+    std::ostream *capture = log_capture();
+    return (capture != nullptr) ? *capture : s;
+  }
+  //! Writes what the calling thread writes during its lifetime straight through, for warnings about more than one permutation
+  class log_capture_suspended
+  {
+    std::ostream *_prev;
+
+  public:
+    log_capture_suspended() noexcept : _prev(log_capture()) { log_capture() = nullptr; }
+    log_capture_suspended(const log_capture_suspended &) = delete;
+    log_capture_suspended &operator=(const log_capture_suspended &) = delete;
+    ~log_capture_suspended() { log_capture() = _prev; }
+  };
+}  // namespace detail
+
 //! Lets you redefine where cout is sent
 #ifndef KERNELTEST_COUT
-#define KERNELTEST_COUT(...) std::cout << __VA_ARGS__
+#define KERNELTEST_COUT(...) KERNELTEST_V1_NAMESPACE::detail::log_stream(std::cout) << __VA_ARGS__
 #endif
 //! Lets you redefine where cerr is sent
 #ifndef KERNELTEST_CERR
-#define KERNELTEST_CERR(...) std::cerr << __VA_ARGS__
+#define KERNELTEST_CERR(...) KERNELTEST_V1_NAMESPACE::detail::log_stream(std::cerr) << __VA_ARGS__
 #endif
 
 //! Many <filesystem> TS implementations are not implementing std::hash for filesystem::path
@@ -244,8 +272,28 @@ static QUICKCPPLIB_THREAD_LOCAL struct current_test_kernel_t
   const char *description;  //!< The human readable description of the test
   //! The working directory for the calling thread, if any (see hooks::filesystem_setup).
   const filesystem::path::value_type *working_directory;
+#ifndef _WIN32
+  //! A file descriptor of `working_directory` for use with the `*at()` calls, only valid while `working_directory` is set.
+  int working_directory_fd;
+#endif
 } current_test_kernel;
 
+namespace detail
+{
+  //! Returns `category/product/test/name` of the current test kernel, which identifies it across runs
+  inline std::string current_test_kernel_identity()
+  {
+    std::string ret;
+    for(const char *i : {current_test_kernel.category, current_test_kernel.product, current_test_kernel.test, current_test_kernel.name})
+    {
+      if(!ret.empty())
+        ret.push_back('/');
+      ret.append((i != nullptr) ? i : "-");
+    }
+    return ret;
+  }
+}  // namespace detail
+
 
 //! \brief Enumeration of the ways in which a kernel test may fail
 enum class kerneltest_errc
@@ -265,6 +313,14 @@ enum class kerneltest_errc
   kernel_signal_thrown = 13,    //!< A signal was thrown during the kernel execution
   teardown_signal_thrown = 14,  //!< A signal was thrown during the kernel teardown
 
+  setup_timed_out = 16,     //!< The timeout expired during the kernel hook setup
+  kernel_timed_out = 17,    //!< The timeout expired during the kernel execution
+  teardown_timed_out = 18,  //!< The timeout expired during the kernel teardown
+
+  latency_budget_exceeded = 20,     //!< The kernel took longer than its latency budget (see hooks::latency_budget)
+  allocations_leaked = 21,          //!< Allocations made during the test were not freed by the end of teardown (see hooks::heap_accounting)
+  allocation_budget_exceeded = 22,  //!< The test allocated more times than its allocation budget (see hooks::heap_accounting)
+
   filesystem_setup_internal_failure = 256,  //!< hooks::filesystem_setup failed during setup or teardown
   filesystem_comparison_internal_failure,   //!< hooks::filesystem_comparison failed during setup or teardown
   filesystem_comparison_failed              //!< hooks::filesystem_comparison found workspaces differed
@@ -302,6 +358,20 @@ namespace detail
     case kerneltest_errc::teardown_signal_thrown:
       return "signal thrown during kernel teardown";
 
+    case kerneltest_errc::setup_timed_out:
+      return "timed out during kernel setup";
+    case kerneltest_errc::kernel_timed_out:
+      return "timed out during kernel execution";
+    case kerneltest_errc::teardown_timed_out:
+      return "timed out during kernel teardown";
+
+    case kerneltest_errc::latency_budget_exceeded:
+      return "kernel exceeded its latency budget";
+    case kerneltest_errc::allocations_leaked:
+      return "allocations were leaked";
+    case kerneltest_errc::allocation_budget_exceeded:
+      return "kernel exceeded its allocation budget";
+
     case kerneltest_errc::filesystem_setup_internal_failure:
       return "filesystem_setup internal failure";
     case kerneltest_errc::filesystem_comparison_internal_failure:
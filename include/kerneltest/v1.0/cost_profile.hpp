@@ -0,0 +1,201 @@
+/* Persisted per permutation cost profiles
+(C) 2026 agent <agent@local>
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#include "config.hpp"
+
+#ifndef KERNELTEST_COST_PROFILE_HPP
+#define KERNELTEST_COST_PROFILE_HPP
+
+#include "shared_file.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+KERNELTEST_V1_NAMESPACE_BEGIN
+
+/*! \brief A persisted record of how long each permutation of each test kernel took to execute.
+
+The profile file is plain text, one line per permutation, each line being the test kernel
+identity, the hash of the parameter set from `hash_parameter_set()`, and the wall time in
+nanoseconds, separated by tabs. A multithreaded `parameter_permuter` with a cost profile
+dispatches the permutations it has costs for longest first, which stops one long permutation
+running alone at the end of the run.
+*/
+class cost_profile
+{
+  mutable std::mutex _lock;
+  filesystem::path _path;
+  std::unordered_map<std::string, std::unordered_map<uint64_t, uint64_t>> _costs;
+
+  void _load()
+  {
+    std::ifstream s(_path);
+    std::string line;
+    while(std::getline(s, line))
+    {
+      auto tab2 = line.rfind('\t');
+      if(tab2 == std::string::npos || tab2 == 0)
+        continue;
+      auto tab1 = line.rfind('\t', tab2 - 1);
+      if(tab1 == std::string::npos)
+        continue;
+      uint64_t hash = strtoull(line.c_str() + tab1 + 1, nullptr, 16);
+      uint64_t nanoseconds = strtoull(line.c_str() + tab2 + 1, nullptr, 10);
+      _costs[line.substr(0, tab1)][hash] = nanoseconds;
+    }
+  }
+
+public:
+  //! Constructs an instance, loading any existing profile file at `path`
+  explicit cost_profile(filesystem::path path)
+      : _path(std::move(path))
+  {
+    _load();
+  }
+  cost_profile(const cost_profile &) = delete;
+  cost_profile &operator=(const cost_profile &) = delete;
+
+  /*! Returns the process wide instance for the profile file at `path`, loading it if necessary.
+  If `path` is empty, the environment variable `KERNELTEST_COST_PROFILE` is used instead, and if
+  that is not set either, a null pointer is returned.
+  */
+  static cost_profile *open(filesystem::path path = {})
+  {
+    if(path.empty())
+    {
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4996)  // Stupid deprecation warning
+#endif
+      auto env = getenv("KERNELTEST_COST_PROFILE");
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+      if(env == nullptr || env[0] == 0)
+        return nullptr;
+      path = env;
+    }
+    static std::mutex lock;
+    static std::unordered_map<filesystem::path, std::unique_ptr<cost_profile>, path_hasher> profiles;
+    std::lock_guard<std::mutex> g(lock);
+    auto &ret = profiles[path];
+    if(!ret)
+      ret.reset(new cost_profile(path));
+    return ret.get();
+  }
+
+  //! The path of the profile file
+  const filesystem::path &path() const noexcept { return _path; }
+
+  //! Fills `nanoseconds` with the recorded costs of `hashes` for `kernel`, zero if unknown. Returns true if any were known.
+  bool costs(const std::string &kernel, const std::vector<uint64_t> &hashes, std::vector<uint64_t> &nanoseconds) const
+  {
+    std::lock_guard<std::mutex> g(_lock);
+    nanoseconds.assign(hashes.size(), 0);
+    auto it = _costs.find(kernel);
+    if(it == _costs.end())
+      return false;
+    bool ret = false;
+    for(size_t n = 0; n < hashes.size(); n++)
+    {
+      auto cost = it->second.find(hashes[n]);
+      if(cost != it->second.end())
+      {
+        nanoseconds[n] = cost->second;
+        ret = true;
+      }
+    }
+    return ret;
+  }
+
+  /*! Records the costs of `hashes` for `kernel` and rewrites the profile file. Entries with zero cost were not run and are ignored.
+  The profile file is locked and read again first, so the costs recorded by other processes sharing it are kept.
+  */
+  void record(const std::string &kernel, const std::vector<uint64_t> &hashes, const std::vector<uint64_t> &nanoseconds)
+  {
+    std::lock_guard<std::mutex> g(_lock);
+    detail::shared_file_lock locked(_path);
+    _costs.clear();
+    _load();
+    auto &costs = _costs[kernel];
+    for(size_t n = 0; n < hashes.size(); n++)
+    {
+      if(nanoseconds[n] != 0)
+        costs[hashes[n]] = nanoseconds[n];
+    }
+    // Write a new file and atomically rename it over the old one, so
+    // a concurrent reader never sees a partially written profile
+    const filesystem::path temp(detail::shared_file_temporary_path(_path));
+    {
+      std::ofstream s(temp, std::ios::trunc);
+      for(auto &k : _costs)
+      {
+        for(auto &i : k.second)
+          s << k.first << '\t' << std::hex << i.first << '\t' << std::dec << i.second << '\n';
+      }
+      if(!s)
+      {
+        KERNELTEST_CERR("WARNING: Couldn't write cost profile " << temp << std::endl);
+        s.close();
+        std::error_code ec;
+        filesystem::remove(temp, ec);
+        return;
+      }
+    }
+    std::error_code ec;
+    filesystem::rename(temp, _path, ec);
+    if(ec)
+    {
+      KERNELTEST_CERR("WARNING: Couldn't replace cost profile " << _path << " due to " << ec.message() << std::endl);
+      filesystem::remove(temp, ec);
+    }
+  }
+};
+
+namespace detail
+{
+  // Returns the dispatch order for a longest processing time first schedule, unknown costs first
+  inline std::vector<size_t> longest_first_order(const std::vector<uint64_t> &nanoseconds)
+  {
+    std::vector<size_t> order(nanoseconds.size());
+    for(size_t n = 0; n < order.size(); n++)
+      order[n] = n;
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+      uint64_t ca = (nanoseconds[a] != 0) ? nanoseconds[a] : UINT64_MAX, cb = (nanoseconds[b] != 0) ? nanoseconds[b] : UINT64_MAX;
+      return ca > cb;
+    });
+    return order;
+  }
+}  // namespace detail
+
+KERNELTEST_V1_NAMESPACE_END
+
+#endif
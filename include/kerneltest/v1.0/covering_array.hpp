@@ -0,0 +1,320 @@
+/* Pairwise and t-wise covering arrays of parameter values
+(C) 2026 agent <agent@local>
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#include "config.hpp"
+
+#ifndef KERNELTEST_COVERING_ARRAY_HPP
+#define KERNELTEST_COVERING_ARRAY_HPP
+
+#include "cartesian_product.hpp"
+
+#include <tuple>
+#include <utility>
+#include <vector>
+
+KERNELTEST_V1_NAMESPACE_BEGIN
+
+namespace detail
+{
+  static constexpr size_t covering_array_dont_care = static_cast<size_t>(-1);
+
+  // Advances combination, a sorted selection of parameters from [0, n), returning false after the last
+  inline bool next_combination(std::vector<size_t> &combination, size_t n)
+  {
+    const size_t k = combination.size();
+    for(size_t m = k; m-- > 0;)
+    {
+      if(combination[m] < n - k + m)
+      {
+        combination[m]++;
+        for(size_t j = m + 1; j < k; j++)
+          combination[j] = combination[j - 1] + 1;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /* Returns rows of value indices, one per parameter with sizes[n] values, such that every
+  combination of the values of any strength parameters appears in at least one row. This is the
+  IPOG (in parameter order, general) strategy: start with every combination of the first strength
+  parameters, then for each further parameter, extend every row with whichever of its values covers
+  the most uncovered combinations, and add rows for the combinations still uncovered.
+  */
+  inline std::vector<std::vector<size_t>> covering_array_rows(size_t strength, const std::vector<size_t> &sizes)
+  {
+    std::vector<std::vector<size_t>> rows;
+    const size_t k = sizes.size();
+    for(size_t size : sizes)
+    {
+      if(size == 0)
+        return rows;
+    }
+    if(strength == 0)
+      strength = 1;
+    const size_t initial = (strength < k) ? strength : k;
+    // Every combination of the first parameters
+    {
+      std::vector<size_t> row(k, covering_array_dont_care);
+      for(size_t n = 0; n < initial; n++)
+        row[n] = 0;
+      for(;;)
+      {
+        rows.push_back(row);
+        size_t n = initial;
+        while(n-- > 0)
+        {
+          if(++row[n] < sizes[n])
+            break;
+          row[n] = 0;
+        }
+        if(n == static_cast<size_t>(-1))
+          break;
+      }
+    }
+    for(size_t i = initial; i < k; i++)
+    {
+      // Every combination of strength - 1 of the earlier parameters, each with a map of which
+      // combinations of their values and a value of parameter i are uncovered
+      struct interaction
+      {
+        std::vector<size_t> parameters;
+        std::vector<char> uncovered;
+      };
+      std::vector<interaction> interactions;
+      {
+        std::vector<size_t> combination(strength - 1);
+        for(size_t n = 0; n < combination.size(); n++)
+          combination[n] = n;
+        do
+        {
+          size_t count = sizes[i];
+          for(size_t p : combination)
+            count *= sizes[p];
+          interactions.push_back({combination, std::vector<char>(count, 1)});
+        } while(!combination.empty() && next_combination(combination, i));
+      }
+      // The index into interaction.uncovered of row, or dont_care if the row doesn't assign all its parameters
+      auto tuple_of = [&](const interaction &in, const std::vector<size_t> &row) {
+        size_t ret = 0;
+        for(size_t p : in.parameters)
+        {
+          if(row[p] == covering_array_dont_care)
+            return covering_array_dont_care;
+          ret = ret * sizes[p] + row[p];
+        }
+        if(row[i] == covering_array_dont_care)
+          return covering_array_dont_care;
+        return ret * sizes[i] + row[i];
+      };
+      // Horizontal growth
+      for(auto &row : rows)
+      {
+        size_t best = 0, best_covered = 0;
+        for(size_t v = 0; v < sizes[i]; v++)
+        {
+          row[i] = v;
+          size_t covered = 0;
+          for(const auto &in : interactions)
+          {
+            size_t t = tuple_of(in, row);
+            if(t != covering_array_dont_care && in.uncovered[t])
+              covered++;
+          }
+          if(covered > best_covered)
+          {
+            best = v;
+            best_covered = covered;
+          }
+        }
+        // Leave rows which would cover nothing new free for vertical growth to use
+        row[i] = (best_covered > 0) ? best : covering_array_dont_care;
+        for(auto &in : interactions)
+        {
+          size_t t = tuple_of(in, row);
+          if(t != covering_array_dont_care)
+            in.uncovered[t] = 0;
+        }
+      }
+      // Vertical growth
+      std::vector<size_t> values(strength);
+      for(auto &in : interactions)
+      {
+        for(size_t t = 0; t < in.uncovered.size(); t++)
+        {
+          if(!in.uncovered[t])
+            continue;
+          // Decompose the tuple into the value of each of its parameters, parameter i last
+          size_t rest = t;
+          values[in.parameters.size()] = rest % sizes[i];
+          rest /= sizes[i];
+          for(size_t n = in.parameters.size(); n-- > 0;)
+          {
+            values[n] = rest % sizes[in.parameters[n]];
+            rest /= sizes[in.parameters[n]];
+          }
+          auto compatible = [&](const std::vector<size_t> &row) {
+            for(size_t n = 0; n < in.parameters.size(); n++)
+            {
+              size_t v = row[in.parameters[n]];
+              if(v != covering_array_dont_care && v != values[n])
+                return false;
+            }
+            return row[i] == covering_array_dont_care || row[i] == values[in.parameters.size()];
+          };
+          std::vector<size_t> *target = nullptr;
+          for(auto &row : rows)
+          {
+            if(compatible(row))
+            {
+              target = &row;
+              break;
+            }
+          }
+          if(target == nullptr)
+          {
+            rows.emplace_back(k, covering_array_dont_care);
+            target = &rows.back();
+          }
+          for(size_t n = 0; n < in.parameters.size(); n++)
+            (*target)[in.parameters[n]] = values[n];
+          (*target)[i] = values[in.parameters.size()];
+          in.uncovered[t] = 0;
+        }
+      }
+    }
+    // Anything still unassigned could be any value
+    for(auto &row : rows)
+    {
+      for(auto &v : row)
+      {
+        if(v == covering_array_dont_care)
+          v = 0;
+      }
+    }
+    return rows;
+  }
+
+  template <class Row, class Outcome, class... Lists, class Expected, class Hooks, size_t... Ks> Row covering_array_row(const std::vector<size_t> &row, const Expected &expected, const Hooks &hooks, std::index_sequence<Ks...>)
+  {
+    return std::tuple_cat(std::make_tuple(Outcome(expected(Lists::value(row[Ks])...)), parameters<typename Lists::value_type...>(Lists::value(row[Ks])...)), hooks);
+  }
+}  // namespace detail
+
+/*! \brief A parameter sequence covering every combination of the values of any `strength()` kernel
+parameters at least once, in far fewer parameter sets than every combination of all the parameters.
+
+This behaves like a `std::vector` of parameter sets, and can be passed to `st_permute_parameters()`
+and `mt_permute_parameters()` directly.
+*/
+template <class T> class covering_array
+{
+  std::vector<T> _rows;
+  size_t _strength;
+  double _combinations;
+
+public:
+  //! The type of a parameter set
+  using value_type = T;
+  //! The type of the size
+  using size_type = size_t;
+  //! The type of an iterator
+  using iterator = typename std::vector<T>::iterator;
+  //! The type of a const iterator
+  using const_iterator = typename std::vector<T>::const_iterator;
+
+  //! Constructs an instance
+  covering_array(std::vector<T> rows, size_t strength, double combinations)
+      : _rows(std::move(rows))
+      , _strength(strength)
+      , _combinations(combinations)
+  {
+  }
+
+  //! The strength of the covering array, two being pairwise
+  size_t strength() const noexcept { return _strength; }
+  //! The number of parameter sets in every combination of all the parameters
+  double combinations() const noexcept { return _combinations; }
+  //! The number of parameter sets in every combination of all the parameters per parameter set in this array
+  double reduction_ratio() const noexcept { return _rows.empty() ? 0 : _combinations / static_cast<double>(_rows.size()); }
+
+  //! The number of parameter sets
+  size_t size() const noexcept { return _rows.size(); }
+  //! True if empty
+  bool empty() const noexcept { return _rows.empty(); }
+  //! The parameter set at `idx`
+  T &operator[](size_t idx) { return _rows[idx]; }
+  //! \overload
+  const T &operator[](size_t idx) const { return _rows[idx]; }
+  //! Iterator to the start of the sequence
+  iterator begin() noexcept { return _rows.begin(); }
+  //! \overload
+  const_iterator begin() const noexcept { return _rows.begin(); }
+  //! Iterator to the end of the sequence
+  iterator end() noexcept { return _rows.end(); }
+  //! \overload
+  const_iterator end() const noexcept { return _rows.end(); }
+  //! \overload
+  const_iterator cbegin() const noexcept { return _rows.cbegin(); }
+  //! \overload
+  const_iterator cend() const noexcept { return _rows.cend(); }
+};
+
+/*! \brief Returns a covering array of strength `strength` over the values in the `value_list`s `Lists`.
+
+Every combination of the values of any `strength` of the parameters appears in at least one
+parameter set, where a `strength` of two is pairwise testing and a `strength` of at least the
+number of parameters is every combination. Each row is
+`parameters<Outcome, parameters<typename Lists::value_type...>, HookParameters...>`, the expected
+outcome of each being `expected(values...)` and every row getting a copy of `hook_parameters`.
+The generation is deterministic, so the same lists always produce the same array.
+
+For example, ten parameters of four values each have a million combinations, but every pair of
+their values is covered in around thirty parameter sets, a `reduction_ratio()` of over thirty thousand.
+\tparam Outcome The type of the outcome of the test kernel.
+\tparam Lists The `value_list` of each kernel parameter.
+*/
+template <class Outcome, class... Lists, class Expected, class... HookParameters> covering_array<parameters<Outcome, parameters<typename Lists::value_type...>, typename std::decay<HookParameters>::type...>> covering_product(size_t strength, const Expected &expected, HookParameters &&... hook_parameters)
+{
+  using row_type = parameters<Outcome, parameters<typename Lists::value_type...>, typename std::decay<HookParameters>::type...>;
+  const std::vector<size_t> sizes{Lists::size...};
+  double combinations = 1;
+  for(size_t size : sizes)
+    combinations *= static_cast<double>(size);
+  const auto hooks = std::make_tuple(std::forward<HookParameters>(hook_parameters)...);
+  std::vector<row_type> rows;
+  for(const auto &row : detail::covering_array_rows(strength, sizes))
+    rows.push_back(detail::covering_array_row<row_type, Outcome, Lists...>(row, expected, hooks, std::index_sequence_for<Lists...>()));
+  return covering_array<row_type>(std::move(rows), strength, combinations);
+}
+
+//! \brief Returns a pairwise covering array over the values in the `value_list`s `Lists`. Equivalent to `covering_product<Outcome, Lists...>(2, ...)`.
+template <class Outcome, class... Lists, class Expected, class... HookParameters> auto pairwise_product(const Expected &expected, HookParameters &&... hook_parameters)
+{
+  return covering_product<Outcome, Lists...>(2, expected, std::forward<HookParameters>(hook_parameters)...);
+}
+
+KERNELTEST_V1_NAMESPACE_END
+
+#endif
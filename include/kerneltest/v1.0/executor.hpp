@@ -0,0 +1,254 @@
+/* Permutation executors
+(C) 2026 agent <agent@local>
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#include "config.hpp"
+
+#ifndef KERNELTEST_EXECUTOR_HPP
+#define KERNELTEST_EXECUTOR_HPP
+
+#include "topology.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+KERNELTEST_V1_NAMESPACE_BEGIN
+
+//! \brief The ways in which a multithreaded `parameter_permuter` can dispatch its permutations
+enum class permuter_executor
+{
+  automatic,   //!< OpenMP if compiled with OpenMP, else the built in work stealing thread pool
+  openmp,      //!< `#pragma omp parallel for` with a dynamic schedule. Falls back to `thread_pool` without OpenMP.
+  thread_pool  //!< The built in work stealing thread pool
+};
+
+/*! \brief A flag shared by all the workers executing a parameter sequence, which once set stops
+them starting any more permutations.
+*/
+class cancellation_token
+{
+  std::atomic<bool> _cancelled{false};
+  std::atomic<size_t> _by{static_cast<size_t>(-1)};
+
+public:
+  //! True if cancelled
+  bool cancelled() const noexcept { return _cancelled.load(std::memory_order_relaxed); }
+  //! The index of the permutation which cancelled, if cancelled by one
+  size_t cancelled_by() const noexcept { return _by.load(std::memory_order_relaxed); }
+  //! Cancels due to the permutation at `idx`, returning false if already cancelled
+  bool cancel(size_t idx = static_cast<size_t>(-1)) noexcept
+  {
+    if(_cancelled.exchange(true))
+      return false;
+    _by.store(idx, std::memory_order_relaxed);
+    return true;
+  }
+};
+
+namespace detail
+{
+  // A half open range of dispatch steps owned by a worker, where step n is position
+  // base + stride * n. The owner claims chunks from the front, thieves take the back half.
+  struct alignas(64) work_stealing_range
+  {
+    std::mutex lock;
+    size_t begin{0}, end{0}, base{0};
+  };
+}  // namespace detail
+
+/*! \brief A work stealing thread pool which calls `f(n)` for every `n` in `[0, count)`.
+
+The positions are initially divided evenly between the workers. Each worker claims
+chunks from the front of its own range, and when that runs dry it steals the back half
+of the range of some other worker. This keeps all workers busy even when some
+permutations take orders of magnitude longer than others.
+
+If the positions are sorted by priority, they can instead be dealt round robin to the
+workers, so every worker starts with the highest priority positions and thieves steal the
+lowest priority positions.
+
+The calling thread participates as the first worker. `current_test_kernel` of the calling
+thread is copied into every worker so hooks see the same test kernel on every thread. If
+given a `worker_affinity`, each worker pins itself before claiming any positions, the calling
+thread getting its previous affinity back afterwards.
+*/
+class work_stealing_executor
+{
+  size_t _workers, _chunk;
+  bool _round_robin;
+  const worker_affinity *_affinity;
+
+public:
+  /*! Constructs an instance.
+  \param workers The number of workers including the calling thread. Zero means `std::thread::hardware_concurrency()`,
+  or the number of cpus used by `affinity` if it restricts them.
+  \param chunk The number of positions claimed per dispatch. Zero means guided chunking, where each claim
+  takes a quarter of what remains in the worker's range, or a single position if dealing round robin.
+  \param round_robin True to deal positions round robin to the workers instead of in contiguous ranges.
+  \param affinity Where the workers may run, which must outlive the instance. Null means anywhere.
+  */
+  constexpr explicit work_stealing_executor(size_t workers = 0, size_t chunk = 0, bool round_robin = false, const worker_affinity *affinity = nullptr) noexcept
+      : _workers(workers)
+      , _chunk(chunk)
+      , _round_robin(round_robin)
+      , _affinity(affinity)
+  {
+  }
+
+  //! The number of workers which would be used for `count` positions
+  size_t workers(size_t count) const
+  {
+    size_t ret = _workers;
+    if(ret == 0 && _affinity != nullptr && _affinity->enabled())
+      ret = _affinity->cpu_count();
+    if(ret == 0)
+    {
+      ret = std::thread::hardware_concurrency();
+      if(ret == 0)
+        ret = 1;
+    }
+    return std::min(ret, count);
+  }
+
+  /*! Calls `f(n)` for every `n` in `[0, count)` using the thread pool, returning when all have completed.
+  \throws anything The first exception thrown by any call of `f`, rethrown after all workers have exited.
+  */
+  template <class F> void operator()(size_t count, F &&f) const
+  {
+    const size_t nworkers = workers(count);
+    if(nworkers <= 1)
+    {
+      detail::worker_affinity_scope pin(_affinity, 0);
+      for(size_t n = 0; n < count; n++)
+        f(n);
+      return;
+    }
+    std::unique_ptr<detail::work_stealing_range[]> ranges(new detail::work_stealing_range[nworkers]);
+    const size_t stride = _round_robin ? nworkers : 1;
+    for(size_t n = 0; n < nworkers; n++)
+    {
+      if(_round_robin)
+      {
+        ranges[n].end = (count - n + nworkers - 1) / nworkers;
+        ranges[n].base = n;
+      }
+      else
+      {
+        ranges[n].begin = count * n / nworkers;
+        ranges[n].end = count * (n + 1) / nworkers;
+      }
+    }
+    std::mutex exception_lock;
+    std::exception_ptr exception;
+    const current_test_kernel_t caller_test_kernel = current_test_kernel;
+    auto worker = [&](size_t me) {
+      current_test_kernel = caller_test_kernel;
+      try
+      {
+        detail::worker_affinity_scope pin(_affinity, me);
+        for(;;)
+        {
+          size_t begin, end, base;
+          {
+            std::lock_guard<std::mutex> g(ranges[me].lock);
+            begin = ranges[me].begin;
+            base = ranges[me].base;
+            size_t remaining = ranges[me].end - begin;
+            if(remaining > 0)
+            {
+              size_t chunk = (_chunk != 0) ? _chunk : _round_robin ? 1 : (remaining / 4);
+              chunk = std::max<size_t>(1, std::min(chunk, remaining));
+              end = begin + chunk;
+              ranges[me].begin = end;
+            }
+            else
+              end = begin;
+          }
+          if(begin == end)
+          {
+            // Our range is exhausted, so steal the back half of someone else's
+            for(size_t n = 1; n < nworkers && begin == end; n++)
+            {
+              auto &victim = ranges[(me + n) % nworkers];
+              std::lock_guard<std::mutex> g(victim.lock);
+              size_t remaining = victim.end - victim.begin;
+              if(remaining > 0)
+              {
+                end = victim.end;
+                begin = end - (remaining + 1) / 2;
+                base = victim.base;
+                victim.end = begin;
+              }
+            }
+            if(begin == end)
+              break;
+            // Claim the first position of what was stolen, and make the rest our own range
+            std::lock_guard<std::mutex> g(ranges[me].lock);
+            ranges[me].begin = begin + 1;
+            ranges[me].end = end;
+            ranges[me].base = base;
+            end = begin + 1;
+          }
+          for(size_t n = begin; n < end; n++)
+            f(base + stride * n);
+        }
+      }
+      catch(...)
+      {
+        std::lock_guard<std::mutex> g(exception_lock);
+        if(!exception)
+          exception = std::current_exception();
+      }
+      current_test_kernel = current_test_kernel_t();
+    };
+    std::vector<std::thread> threads;
+    try
+    {
+      threads.reserve(nworkers - 1);
+      for(size_t n = 1; n < nworkers; n++)
+        threads.emplace_back(worker, n);
+    }
+    catch(...)
+    {
+      // Couldn't launch all the workers, the ranges of those missing get stolen
+    }
+    {
+      // The calling thread is the first worker, and must keep its own test kernel afterwards
+      auto restore = make_scope_exit([&]() noexcept { current_test_kernel = caller_test_kernel; });
+      worker(0);
+    }
+    for(auto &i : threads)
+      i.join();
+    if(exception)
+      std::rethrow_exception(exception);
+  }
+};
+
+KERNELTEST_V1_NAMESPACE_END
+
+#endif
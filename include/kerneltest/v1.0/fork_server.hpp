@@ -0,0 +1,481 @@
+/* Crash isolated execution of permutations in forked worker processes
+(C) 2026 agent <agent@local>
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#include "config.hpp"
+
+#ifndef KERNELTEST_FORK_SERVER_HPP
+#define KERNELTEST_FORK_SERVER_HPP
+
+#include "executor.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+KERNELTEST_V1_NAMESPACE_BEGIN
+
+namespace detail
+{
+  // Shared between a fork server worker and its parent, so the parent knows what the
+  // worker was doing if it dies or hangs
+  struct fork_server_slot
+  {
+    volatile int stage;
+    volatile uint64_t position;
+    volatile int64_t deadline;  // zero if not executing a position with a timeout
+  };
+
+  inline int64_t fork_server_now() noexcept { return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count(); }
+
+#ifndef _WIN32
+  inline bool fork_server_read(int fd, void *buffer, size_t length) noexcept
+  {
+    auto *p = static_cast<char *>(buffer);
+    while(length > 0)
+    {
+      ssize_t bytes = ::read(fd, p, length);
+      if(bytes == -1 && errno == EINTR)
+        continue;
+      if(bytes <= 0)
+        return false;
+      p += bytes;
+      length -= static_cast<size_t>(bytes);
+    }
+    return true;
+  }
+  inline bool fork_server_write(int fd, const void *buffer, size_t length) noexcept
+  {
+    auto *p = static_cast<const char *>(buffer);
+    while(length > 0)
+    {
+      ssize_t bytes = ::write(fd, p, length);
+      if(bytes == -1 && errno == EINTR)
+        continue;
+      if(bytes <= 0)
+        return false;
+      p += bytes;
+      length -= static_cast<size_t>(bytes);
+    }
+    return true;
+  }
+#endif
+}  // namespace detail
+
+/*! \brief A pool of worker processes which calls `execute(n, stage)` for every `n` in `[0, count)`.
+
+The workers are forked from the calling process once it has been initialised, and then
+serve batch after batch of positions sent down a pipe, returning the string produced by
+`execute()` for each position up another pipe. Process startup, static initialisation and
+anything else already warm in the calling process are therefore paid for once per worker
+rather than once per position. `execute()` publishes which stage of a permutation it is
+in via `stage`, which lives in memory shared with the calling process.
+
+If a worker dies, because the permutation it was executing raised a fatal signal or called
+`exit()`, or because the permutation ran for longer than the timeout and was killed, `died()`
+is called for the position it was executing and a replacement worker is forked to carry on
+with the rest of its batch.
+
+Note that a worker forked from a multithreaded process has only the thread which forked it,
+so the calling process should not be holding locks in other threads. On Windows, which
+cannot fork, every position is executed in the calling process instead.
+*/
+class fork_server
+{
+  size_t _workers, _batch;
+  std::chrono::milliseconds _timeout;
+  const cancellation_token *_cancel;
+
+public:
+  /*! Constructs an instance.
+  \param workers The number of worker processes. Zero means `std::thread::hardware_concurrency()`.
+  \param batch The number of positions sent to a worker at a time. Zero means a quarter of an even
+  share of what remains.
+  \param timeout How long a single position may execute before its worker is killed. Zero means forever.
+  \param cancel If not null, once cancelled no more positions are sent to the workers, and those not
+  yet sent are never executed.
+  */
+  constexpr explicit fork_server(size_t workers = 0, size_t batch = 0, std::chrono::milliseconds timeout = std::chrono::milliseconds(0), const cancellation_token *cancel = nullptr) noexcept
+      : _workers(workers)
+      , _batch(batch)
+      , _timeout(timeout)
+      , _cancel(cancel)
+  {
+  }
+
+  //! The number of workers which would be used for `count` positions
+  size_t workers(size_t count) const noexcept
+  {
+    size_t ret = _workers;
+    if(ret == 0)
+    {
+      ret = std::thread::hardware_concurrency();
+      if(ret == 0)
+        ret = 1;
+    }
+    return std::min(ret, count);
+  }
+
+  /*! Executes every position in `[0, count)` in the worker processes, returning when all have completed.
+  Each position may execute for the timeout given on construction.
+  \param execute Some callable with callspec `std::string(size_t n, volatile int &stage)`, called in a worker.
+  \param complete Some callable with callspec `void(size_t n, const char *data, size_t length)`, called in
+  this process with what `execute()` returned for `n`.
+  \param died Some callable with callspec `void(size_t n, int stage, int signo, bool timed_out)`, called in this
+  process if the worker executing `n` died. `signo` is the signal which killed it, or zero if it exited.
+  \throws std::system_error If the pipes, shared memory or worker processes could not be created.
+  \throws anything Any exception thrown by `complete()` or `died()`, after all workers have been killed.
+  */
+  template <class Execute, class Complete, class Died> void operator()(size_t count, Execute &&execute, Complete &&complete, Died &&died) const
+  {
+    const std::chrono::milliseconds timeout = _timeout;
+    (*this)(count, std::forward<Execute>(execute), std::forward<Complete>(complete), std::forward<Died>(died), [timeout](size_t) { return timeout; });
+  }
+
+  /*! \overload
+  \param timeout_of Some callable with callspec `std::chrono::milliseconds(size_t n)` returning how long position
+  `n` may execute, zero meaning forever, instead of the timeout given on construction. Called in the worker.
+  */
+  template <class Execute, class Complete, class Died, class TimeoutOf> void operator()(size_t count, Execute &&execute, Complete &&complete, Died &&died, TimeoutOf &&timeout_of) const
+  {
+#ifdef _WIN32
+    (void) died;
+    (void) timeout_of;
+    for(size_t n = 0; n < count && (_cancel == nullptr || !_cancel->cancelled()); n++)
+    {
+      volatile int stage = 0;
+      const std::string payload = execute(n, stage);
+      complete(n, payload.data(), payload.size());
+    }
+#else
+    const size_t nworkers = workers(count);
+    if(nworkers == 0)
+      return;
+    // The workers inherit any unwritten stdio buffers, which would otherwise be written twice
+    std::cout.flush();
+    std::cerr.flush();
+    fflush(nullptr);
+    // A worker dying while we send it a batch must not kill us too
+    struct sigaction ignore_sigpipe, old_sigpipe;
+    memset(&ignore_sigpipe, 0, sizeof(ignore_sigpipe));
+    ignore_sigpipe.sa_handler = SIG_IGN;
+    sigaction(SIGPIPE, &ignore_sigpipe, &old_sigpipe);
+    auto restore_sigpipe = make_scope_exit([&]() noexcept { sigaction(SIGPIPE, &old_sigpipe, nullptr); });
+    void *mem = ::mmap(nullptr, nworkers * sizeof(detail::fork_server_slot), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if(mem == MAP_FAILED)
+      throw std::system_error(errno, std::system_category());
+    auto unmap = make_scope_exit([&]() noexcept { ::munmap(mem, nworkers * sizeof(detail::fork_server_slot)); });
+    auto *slots = static_cast<detail::fork_server_slot *>(mem);
+
+    struct worker
+    {
+      pid_t pid{-1};
+      int command{-1}, result{-1};
+      std::vector<uint64_t> batch;
+      size_t received{0};
+      std::string buffer;
+    };
+    std::vector<worker> ws(nworkers);
+    std::deque<uint64_t> requeued;
+    size_t next = 0, done = 0;
+    auto remaining = [&] { return requeued.size() + (count - next); };
+    auto close_pipes = [](worker &w) noexcept {
+      if(w.command != -1)
+        ::close(w.command);
+      if(w.result != -1)
+        ::close(w.result);
+      w.command = w.result = -1;
+    };
+    // Never leave workers behind, whether we finished or something threw
+    auto reap_all = make_scope_exit([&]() noexcept {
+      for(auto &w : ws)
+      {
+        if(w.pid == -1)
+          continue;
+        if(!w.batch.empty())
+          ::kill(w.pid, SIGKILL);
+        close_pipes(w);
+        int status;
+        while(::waitpid(w.pid, &status, 0) == -1 && errno == EINTR)
+          ;
+        w.pid = -1;
+      }
+    });
+    auto serve = [&](size_t me, int command, int result) noexcept {
+      auto &slot = slots[me];
+      try
+      {
+        for(;;)
+        {
+          uint32_t length = 0;
+          if(!detail::fork_server_read(command, &length, sizeof(length)))
+            break;
+          std::vector<uint64_t> batch(length);
+          if(!detail::fork_server_read(command, batch.data(), length * sizeof(uint64_t)))
+            break;
+          for(uint64_t position : batch)
+          {
+            slot.stage = 0;
+            slot.position = position;
+            const int64_t timeout_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(timeout_of(static_cast<size_t>(position))).count();
+            slot.deadline = (timeout_ns > 0) ? detail::fork_server_now() + timeout_ns : 0;
+            const std::string payload = execute(static_cast<size_t>(position), slot.stage);
+            slot.deadline = 0;
+            std::cout.flush();
+            fflush(nullptr);
+            const uint32_t payload_length = static_cast<uint32_t>(payload.size());
+            if(!detail::fork_server_write(result, &position, sizeof(position)) || !detail::fork_server_write(result, &payload_length, sizeof(payload_length)) || !detail::fork_server_write(result, payload.data(), payload.size()))
+              ::_exit(1);
+          }
+        }
+      }
+      catch(...)
+      {
+        ::_exit(2);
+      }
+      // Don't run the destructors and atexit handlers of the parent's state
+      ::_exit(0);
+    };
+    auto spawn = [&](size_t me) {
+      auto &w = ws[me];
+      int command[2], result[2];
+      if(::pipe(command) == -1)
+        throw std::system_error(errno, std::system_category());
+      if(::pipe(result) == -1)
+      {
+        int errcode = errno;
+        ::close(command[0]);
+        ::close(command[1]);
+        throw std::system_error(errcode, std::system_category());
+      }
+      // Don't let anything a permutation executes hold our pipes open
+      for(int fd : {command[0], command[1], result[0], result[1]})
+        ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+      slots[me].stage = 0;
+      slots[me].deadline = 0;
+      pid_t pid = ::fork();
+      if(pid == -1)
+      {
+        int errcode = errno;
+        for(int fd : {command[0], command[1], result[0], result[1]})
+          ::close(fd);
+        throw std::system_error(errcode, std::system_category());
+      }
+      if(pid == 0)
+      {
+        ::close(command[1]);
+        ::close(result[0]);
+        for(auto &o : ws)
+          close_pipes(o);
+        sigaction(SIGPIPE, &old_sigpipe, nullptr);
+        serve(me, command[0], result[1]);
+      }
+      ::close(command[0]);
+      ::close(result[1]);
+      ::fcntl(result[0], F_SETFL, ::fcntl(result[0], F_GETFL) | O_NONBLOCK);
+      w.pid = pid;
+      w.command = command[1];
+      w.result = result[0];
+    };
+    // Reaps a worker which has exited or been killed
+    auto wait = [&](worker &w) noexcept {
+      int status = 0;
+      while(::waitpid(w.pid, &status, 0) == -1 && errno == EINTR)
+        ;
+      w.pid = -1;
+      return status;
+    };
+    // Sends an idle worker its next batch, or if there is no more work, tells it to exit
+    auto dispatch = [&](size_t me) {
+      auto &w = ws[me];
+      w.batch.clear();
+      w.received = 0;
+      size_t batch = (_batch != 0) ? _batch : (remaining() / (nworkers * 4));
+      batch = std::max<size_t>(1, std::min<size_t>(batch, 4096));
+      while(w.batch.size() < batch && !requeued.empty())
+      {
+        w.batch.push_back(requeued.front());
+        requeued.pop_front();
+      }
+      while(w.batch.size() < batch && next < count)
+        w.batch.push_back(next++);
+      if(w.batch.empty())
+      {
+        // Closing its command pipe makes the worker exit
+        close_pipes(w);
+        wait(w);
+        return;
+      }
+      const uint32_t length = static_cast<uint32_t>(w.batch.size());
+      if(!detail::fork_server_write(w.command, &length, sizeof(length)) || !detail::fork_server_write(w.command, w.batch.data(), w.batch.size() * sizeof(uint64_t)))
+      {
+        // The worker died between batches, so its replacement gets this batch
+        for(auto it = w.batch.rbegin(); it != w.batch.rend(); ++it)
+          requeued.push_front(*it);
+        w.batch.clear();
+        close_pipes(w);
+        wait(w);
+      }
+    };
+    // Consumes whatever the worker has returned, returning false once its result pipe has closed
+    auto drain = [&](size_t me) {
+      auto &w = ws[me];
+      bool open = true;
+      char buffer[65536];
+      for(;;)
+      {
+        ssize_t bytes = ::read(w.result, buffer, sizeof(buffer));
+        if(bytes > 0)
+        {
+          w.buffer.append(buffer, static_cast<size_t>(bytes));
+          continue;
+        }
+        if(bytes == -1 && errno == EINTR)
+          continue;
+        if(bytes == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+          open = false;
+        break;
+      }
+      const size_t header = sizeof(uint64_t) + sizeof(uint32_t);
+      size_t offset = 0;
+      while(w.buffer.size() - offset >= header)
+      {
+        uint64_t position;
+        uint32_t length;
+        memcpy(&position, w.buffer.data() + offset, sizeof(position));
+        memcpy(&length, w.buffer.data() + offset + sizeof(position), sizeof(length));
+        if(w.buffer.size() - offset - header < length)
+          break;
+        complete(static_cast<size_t>(position), w.buffer.data() + offset + header, length);
+        offset += header + length;
+        w.received++;
+        done++;
+      }
+      w.buffer.erase(0, offset);
+      return open;
+    };
+    // The worker has died or is to be killed, so report what it was executing and requeue the rest of its batch
+    auto reap = [&](size_t me, bool timed_out) {
+      auto &w = ws[me];
+      if(timed_out)
+        ::kill(w.pid, SIGKILL);
+      const int status = wait(w);
+      drain(me);
+      close_pipes(w);
+      w.buffer.clear();
+      if(w.received < w.batch.size())
+      {
+        const uint64_t position = w.batch[w.received];
+        for(size_t n = w.received + 1; n < w.batch.size(); n++)
+          requeued.push_back(w.batch[n]);
+        w.batch.clear();
+        done++;
+        died(static_cast<size_t>(position), slots[me].stage, WIFSIGNALED(status) ? WTERMSIG(status) : 0, timed_out);
+      }
+      w.batch.clear();
+    };
+
+    std::vector<pollfd> fds;
+    std::vector<size_t> polled;
+    while(done < count)
+    {
+      if(_cancel != nullptr && _cancel->cancelled())
+      {
+        // Abandon everything not yet sent
+        done += remaining();
+        requeued.clear();
+        next = count;
+      }
+      // Replace dead workers and keep every worker busy
+      for(size_t me = 0; me < nworkers; me++)
+      {
+        if(ws[me].pid == -1 && remaining() > 0)
+          spawn(me);
+        if(ws[me].pid != -1 && ws[me].batch.empty())
+          dispatch(me);
+      }
+      fds.clear();
+      polled.clear();
+      int timeout = -1;
+      const int64_t now = detail::fork_server_now();
+      for(size_t me = 0; me < nworkers; me++)
+      {
+        if(ws[me].pid == -1 || ws[me].batch.empty())
+          continue;
+        fds.push_back({ws[me].result, POLLIN, 0});
+        polled.push_back(me);
+        // A worker yet to start its position may be about to set a deadline, so look again soon
+        const int64_t deadline = slots[me].deadline;
+        const int left = (deadline != 0) ? static_cast<int>(std::max<int64_t>((deadline - now) / 1000000 + 1, 0)) : 100;
+        timeout = (timeout < 0) ? left : std::min(timeout, left);
+      }
+      if(fds.empty())
+        continue;
+      if(::poll(fds.data(), static_cast<nfds_t>(fds.size()), timeout) == -1)
+      {
+        if(errno == EINTR)
+          continue;
+        throw std::system_error(errno, std::system_category());
+      }
+      for(size_t n = 0; n < fds.size(); n++)
+      {
+        const size_t me = polled[n];
+        if(fds[n].revents == 0)
+          continue;
+        if(!drain(me))
+          reap(me, false);
+        else if(ws[me].received == ws[me].batch.size())
+          ws[me].batch.clear();
+      }
+      const int64_t later = detail::fork_server_now();
+      for(size_t me = 0; me < nworkers; me++)
+      {
+        const int64_t deadline = slots[me].deadline;
+        if(ws[me].pid != -1 && !ws[me].batch.empty() && deadline != 0 && later > deadline)
+          reap(me, true);
+      }
+    }
+#endif
+  }
+};
+
+KERNELTEST_V1_NAMESPACE_END
+
+#endif
@@ -0,0 +1,171 @@
+/* Parameter sequences generated on demand
+(C) 2026 agent <agent@local>
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#include "config.hpp"
+
+#ifndef KERNELTEST_GENERATED_SEQUENCE_HPP
+#define KERNELTEST_GENERATED_SEQUENCE_HPP
+
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+
+KERNELTEST_V1_NAMESPACE_BEGIN
+
+/*! \brief A sequence of parameter sets of length `size` whose element at `idx` is generated when needed
+by calling `generator(idx)`, so the sequence never exists in memory.
+
+The generator must be a pure function of the index which can be called concurrently from many
+threads, because the permutation at each index is generated by whichever worker executes it,
+and again by anything which later prints or checks it. For example, the cartesian product of
+three enumerations can be generated by decomposing the index into one index per enumeration.
+
+Elements are returned by value, so the sequence can be iterated with `const auto &` or `auto &&`
+but not `auto &`.
+
+Sharding and `parameter_permuter::stream()` only ever generate the permutations they execute.
+A cost profile or result cache however hashes every permutation of the sequence before any is
+executed, taking time and memory in proportion to its length, so is best not used with very long
+generated sequences. A warning is printed if one is.
+*/
+template <class T, class Generator> class generated_sequence
+{
+  size_t _size;
+  Generator _generator;
+
+public:
+  //! The type of a parameter set
+  using value_type = T;
+  //! The type returned by dereferencing an iterator
+  using reference = T;
+  //! \overload
+  using const_reference = T;
+  //! The type of the size
+  using size_type = size_t;
+  //! The type of the difference between two iterators
+  using difference_type = ptrdiff_t;
+
+  //! An iterator generating the parameter set at its position when dereferenced
+  class const_iterator
+  {
+    const generated_sequence *_parent{nullptr};
+    size_t _idx{0};
+
+  public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = T;
+    using difference_type = ptrdiff_t;
+    using pointer = void;
+    using reference = T;
+
+    constexpr const_iterator() noexcept = default;
+    constexpr const_iterator(const generated_sequence *parent, size_t idx) noexcept
+        : _parent(parent)
+        , _idx(idx)
+    {
+    }
+    T operator*() const { return (*_parent)[_idx]; }
+    T operator[](difference_type n) const { return (*_parent)[_idx + n]; }
+    const_iterator &operator++() noexcept
+    {
+      ++_idx;
+      return *this;
+    }
+    const_iterator operator++(int) noexcept
+    {
+      const_iterator ret(*this);
+      ++_idx;
+      return ret;
+    }
+    const_iterator &operator--() noexcept
+    {
+      --_idx;
+      return *this;
+    }
+    const_iterator operator--(int) noexcept
+    {
+      const_iterator ret(*this);
+      --_idx;
+      return ret;
+    }
+    const_iterator &operator+=(difference_type n) noexcept
+    {
+      _idx += n;
+      return *this;
+    }
+    const_iterator &operator-=(difference_type n) noexcept
+    {
+      _idx -= n;
+      return *this;
+    }
+    const_iterator operator+(difference_type n) const noexcept { return const_iterator(_parent, _idx + n); }
+    const_iterator operator-(difference_type n) const noexcept { return const_iterator(_parent, _idx - n); }
+    difference_type operator-(const const_iterator &o) const noexcept { return static_cast<difference_type>(_idx) - static_cast<difference_type>(o._idx); }
+    bool operator==(const const_iterator &o) const noexcept { return _idx == o._idx; }
+    bool operator!=(const const_iterator &o) const noexcept { return _idx != o._idx; }
+    bool operator<(const const_iterator &o) const noexcept { return _idx < o._idx; }
+    bool operator>(const const_iterator &o) const noexcept { return _idx > o._idx; }
+    bool operator<=(const const_iterator &o) const noexcept { return _idx <= o._idx; }
+    bool operator>=(const const_iterator &o) const noexcept { return _idx >= o._idx; }
+  };
+  //! \overload
+  using iterator = const_iterator;
+
+  //! Constructs an instance
+  constexpr generated_sequence(size_t size, Generator generator)
+      : _size(size)
+      , _generator(std::move(generator))
+  {
+  }
+
+  //! The number of parameter sets in the sequence
+  constexpr size_t size() const noexcept { return _size; }
+  //! True if the sequence is empty
+  constexpr bool empty() const noexcept { return _size == 0; }
+  //! Generates the parameter set at `idx`
+  T operator[](size_t idx) const { return _generator(idx); }
+
+  //! Iterator to the start of the sequence
+  const_iterator begin() const noexcept { return const_iterator(this, 0); }
+  //! Iterator to the end of the sequence
+  const_iterator end() const noexcept { return const_iterator(this, _size); }
+  //! \overload
+  const_iterator cbegin() const noexcept { return begin(); }
+  //! \overload
+  const_iterator cend() const noexcept { return end(); }
+};
+
+/*! \brief Returns a sequence of `size` parameter sets generated on demand by `generator(idx)`, which
+must return a `parameters<outcome, parameters<kernel parameters...>, hook parameters...>`.
+*/
+template <class Generator> constexpr auto generate_parameters(size_t size, Generator &&generator)
+{
+  using generator_type = typename std::decay<Generator>::type;
+  using value_type = typename std::decay<decltype(std::declval<const generator_type &>()(size_t(0)))>::type;
+  return generated_sequence<value_type, generator_type>(size, std::forward<Generator>(generator));
+}
+
+KERNELTEST_V1_NAMESPACE_END
+
+#endif
@@ -30,14 +30,71 @@ Distributed under the Boost Software License, Version 1.0.
 #include "quickcpplib/algorithm/string.hpp"
 #include "quickcpplib/utils/thread.hpp"
 
+#include <condition_variable>
 #include <fstream>
+#include <memory>
 #include <mutex>
+#include <thread>
 #include <unordered_map>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+#ifdef __linux__
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
 
 KERNELTEST_V1_NAMESPACE_BEGIN
 
 namespace hooks
 {
+  //! How `filesystem_setup()` clones the files of a workspace template into each workspace
+  enum class workspace_clone
+  {
+    automatic,  //!< `reflink`
+    copy,       //!< Copies the contents of each file
+    /*! Clones each file with `FICLONE`, which shares the extents of the template on btrfs and XFS until either is
+    written, and failing that with `copy_file_range()`, which lets the filesystem copy without the data passing
+    through user space. Falls back to `copy` where neither is supported, including on platforms other than Linux.
+    */
+    reflink,
+    /*! Hard links each file to the template, which is nearly free however big the file. Only use this where the
+    kernels never modify the files of the template in place, as the template would be modified too. Creating,
+    renaming and deleting files in the workspace is fine. Falls back to `copy` where hard links are not supported.
+    */
+    hardlink
+  };
+  //! How `filesystem_setup()` makes each workspace available to the kernel
+  enum class workspace_mode
+  {
+    /*! Changes the working directory of the process to the workspace. As the working directory is shared by every
+    thread, only one permutation at a time may use a workspace.
+    */
+    working_directory,
+    /*! Leaves the working directory alone, so the workspaces of many threads can be used at once. Kernels find
+    their workspace through `current_test_kernel.working_directory`, or on POSIX use the `*at()` calls with
+    `current_test_kernel.working_directory_fd`.
+    */
+    directory_fd
+  };
+  //! What `filesystem_setup()` does with each workspace after the kernel
+  enum class workspace_teardown
+  {
+    remove,  //!< Deletes the workspace, so the next permutation gets a workspace materialised afresh
+    /*! Keeps the workspace, and before the next permutation on the same thread which uses the same template,
+    restores only what differs from the template. Much cheaper than `remove` where kernels modify a few items of a
+    big template. Workspaces are deleted as `remove` does where recycling is not possible: when the thread exits, in
+    processes forked by `parameter_permuter::isolated()`, and on Windows.
+    */
+    recycle
+  };
+
   namespace filesystem_setup_impl
   {
     //! Record the current working directory and store it
@@ -213,35 +270,674 @@ namespace hooks
       }
     }
 
+#ifdef __linux__
+    // Clones src to dest by FICLONE, else by copy_file_range(), returning false if neither is supported for these files
+    inline bool reflink_file(const filesystem::path &src, const filesystem::path &dest, std::error_code &ec)
+    {
+      int srcfd = ::open(src.c_str(), O_RDONLY | O_CLOEXEC);
+      if(srcfd < 0)
+      {
+        ec = std::error_code(errno, std::system_category());
+        return true;
+      }
+      struct stat st;
+      if(fstat(srcfd, &st) < 0)
+      {
+        ec = std::error_code(errno, std::system_category());
+        ::close(srcfd);
+        return true;
+      }
+      int destfd = ::open(dest.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, st.st_mode & 07777);
+      if(destfd < 0)
+      {
+        ec = std::error_code(errno, std::system_category());
+        ::close(srcfd);
+        return true;
+      }
+      bool cloned = (ioctl(destfd, FICLONE, srcfd) == 0);
+#ifdef __NR_copy_file_range
+      if(!cloned)
+      {
+        cloned = true;
+        for(off_t remaining = st.st_size; remaining > 0;)
+        {
+          ssize_t written = syscall(__NR_copy_file_range, srcfd, nullptr, destfd, nullptr, static_cast<size_t>(remaining), 0u);
+          if(written <= 0)
+          {
+            // Unsupported, or the file shrank since fstat(), either way let the caller copy it
+            cloned = false;
+            break;
+          }
+          remaining -= written;
+        }
+      }
+#endif
+      ::close(destfd);
+      ::close(srcfd);
+      if(!cloned)
+        ::unlink(dest.c_str());
+      return cloned;
+    }
+#endif
+    /* Clones the file src to dest as strategy says, downgrading strategy to copy if it
+    turns out to be unsupported, so the rest of the workspace doesn't try it again.
+    */
+    inline void clone_file(const filesystem::path &src, const filesystem::path &dest, workspace_clone &strategy, std::error_code &ec)
+    {
+      if(strategy == workspace_clone::hardlink)
+      {
+        filesystem::create_hard_link(src, dest, ec);
+        if(!ec)
+          return;
+        ec.clear();
+        strategy = workspace_clone::copy;
+      }
+#ifdef __linux__
+      if(strategy == workspace_clone::reflink || strategy == workspace_clone::automatic)
+      {
+        if(reflink_file(src, dest, ec))
+          return;
+        strategy = workspace_clone::copy;
+      }
+#endif
+      filesystem::copy_file(src, dest, ec);
+    }
+
+    //! As `workspace_template_path()`, but only looks for the template of each workspace of each product once per process
+    template <bool is_throwing = false> inline filesystem::path cached_workspace_template_path(const filesystem::path &workspace)  // noexcept(!is_throwing)
+    {
+      static std::mutex lock;
+      static std::unordered_map<std::string, filesystem::path> templates;
+      std::string key(current_test_kernel.product != nullptr ? current_test_kernel.product : "");
+      key.push_back('\0');
+      key.append(workspace.string());
+      {
+        std::lock_guard<std::mutex> g(lock);
+        auto it = templates.find(key);
+        if(it != templates.end())
+          return it->second;
+      }
+      filesystem::path ret(workspace_template_path<is_throwing>(workspace));
+      std::lock_guard<std::mutex> g(lock);
+      templates.emplace(std::move(key), ret);
+      return ret;
+    }
+
+#ifndef _WIN32
+    /*! An immutable snapshot of a workspace template, taken the first time the template is used by this process,
+    from which workspaces are materialised without walking the template again. Files up to `inline_limit` bytes
+    are held in memory and written out, bigger files are cloned from the template as the `workspace_clone` says.
+    Changes to the template after it was first used are therefore not seen.
+    */
+    class template_manifest
+    {
+    public:
+      //! The biggest file whose contents are held in memory
+      static constexpr uint64_t inline_limit = 65536;
+      enum class entry_type
+      {
+        directory,
+        file,
+        symlink
+      };
+      struct entry
+      {
+        entry_type type;
+        std::string path;       //!< Relative to the template, parents before children
+        unsigned mode;          //!< The permission bits
+        std::string target;     //!< The target of a symlink
+        bool inlined;           //!< True if `contents` holds the contents of a file
+        std::string contents;   //!< The contents of a file of at most `inline_limit` bytes
+        uint64_t size;          //!< The size of a file
+        struct timespec mtime;  //!< The last modification time of a file, which its clones are given too
+      };
+
+    private:
+      filesystem::path _source;
+      std::vector<entry> _entries;
+      std::unordered_map<std::string, size_t> _index;
+
+      static bool _type_of(const struct stat &st, entry_type &type) noexcept
+      {
+        if(S_ISLNK(st.st_mode))
+          type = entry_type::symlink;
+        else if(S_ISDIR(st.st_mode))
+          type = entry_type::directory;
+        else if(S_ISREG(st.st_mode))
+          type = entry_type::file;
+        else
+          return false;
+        return true;
+      }
+      static struct timespec _mtime_of(const struct stat &st) noexcept
+      {
+#ifdef __APPLE__
+        return st.st_mtimespec;
+#else
+        return st.st_mtim;
+#endif
+      }
+
+      void _scan(const filesystem::path &dir, const std::string &prefix, std::error_code &ec)
+      {
+        for(filesystem::directory_iterator it(dir, ec); !ec && it != filesystem::directory_iterator(); it.increment(ec))
+        {
+          struct stat st;
+          if(::lstat(it->path().c_str(), &st) < 0)
+          {
+            ec = std::error_code(errno, std::system_category());
+            return;
+          }
+          entry e;
+          if(!_type_of(st, e.type))
+            continue;
+          e.path = prefix + it->path().filename().string();
+          e.mode = static_cast<unsigned>(st.st_mode) & 07777;
+          e.inlined = false;
+          e.size = static_cast<uint64_t>(st.st_size);
+          e.mtime = _mtime_of(st);
+          _index.emplace(e.path, _entries.size());
+          switch(e.type)
+          {
+          case entry_type::symlink:
+            e.target = filesystem::read_symlink(it->path(), ec).string();
+            if(ec)
+              return;
+            _entries.push_back(std::move(e));
+            break;
+          case entry_type::directory:
+          {
+            std::string subprefix = e.path + "/";
+            _entries.push_back(std::move(e));
+            _scan(it->path(), subprefix, ec);
+            if(ec)
+              return;
+            break;
+          }
+          case entry_type::file:
+            if(e.size <= inline_limit)
+            {
+              std::ifstream in(it->path(), std::ios::binary);
+              e.contents.resize(static_cast<size_t>(e.size));
+              if(!in.read(&e.contents[0], static_cast<std::streamsize>(e.size)))
+              {
+                ec = std::make_error_code(std::errc::io_error);
+                return;
+              }
+              e.inlined = true;
+            }
+            _entries.push_back(std::move(e));
+            break;
+          }
+        }
+      }
+
+      // Creates the item i inside dest, which is open as dirfd, cloning big files as clone says. Directories are
+      // created writable so they can be filled in, and are given their permissions by _set_directory_modes() after.
+      void _create(int dirfd, const filesystem::path &dest, const entry &i, workspace_clone &clone, std::error_code &ec) const
+      {
+        switch(i.type)
+        {
+        case entry_type::directory:
+          if(::mkdirat(dirfd, i.path.c_str(), 0700) < 0)
+            ec = std::error_code(errno, std::system_category());
+          return;
+        case entry_type::symlink:
+          if(::symlinkat(i.target.c_str(), dirfd, i.path.c_str()) < 0)
+            ec = std::error_code(errno, std::system_category());
+          return;
+        case entry_type::file:
+          break;
+        }
+        if(!i.inlined || clone == workspace_clone::hardlink)
+        {
+          clone_file(_source / i.path, dest / i.path, clone, ec);
+          if(ec || clone == workspace_clone::hardlink)
+            return;
+          // Clones are given the modification time of the template, so recycle() can tell if they were written
+          const struct timespec times[2] = {{0, UTIME_OMIT}, i.mtime};
+          if(::utimensat(dirfd, i.path.c_str(), times, AT_SYMLINK_NOFOLLOW) < 0)
+            ec = std::error_code(errno, std::system_category());
+          return;
+        }
+        int fd = ::openat(dirfd, i.path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, i.mode);
+        if(fd < 0)
+        {
+          ec = std::error_code(errno, std::system_category());
+          return;
+        }
+        for(size_t written = 0; written < i.contents.size();)
+        {
+          ssize_t bytes = ::write(fd, i.contents.data() + written, i.contents.size() - written);
+          if(bytes < 0)
+          {
+            ec = std::error_code(errno, std::system_category());
+            ::close(fd);
+            return;
+          }
+          written += static_cast<size_t>(bytes);
+        }
+        // Not masked by the umask, as filesystem::copy_file() would not be either
+        if(::fchmod(fd, i.mode) < 0)
+          ec = std::error_code(errno, std::system_category());
+        ::close(fd);
+      }
+      // Gives the directories inside dirfd the permissions of the template, children before parents so
+      // that a directory the template has unwritable or unsearchable doesn't get in the way
+      void _set_directory_modes(int dirfd, std::error_code &ec) const
+      {
+        for(auto it = _entries.rbegin(); it != _entries.rend(); ++it)
+        {
+          if(it->type == entry_type::directory && ::fchmodat(dirfd, it->path.c_str(), it->mode, 0) < 0)
+          {
+            ec = std::error_code(errno, std::system_category());
+            return;
+          }
+        }
+      }
+      // True if the item st at i.path inside dirfd, already known to be of the right type, still matches i
+      bool _matches(int dirfd, const entry &i, const struct stat &st) const
+      {
+        if((static_cast<unsigned>(st.st_mode) & 07777) != i.mode)
+          return false;
+        switch(i.type)
+        {
+        case entry_type::directory:
+          return true;
+        case entry_type::symlink:
+        {
+          std::string target(i.target.size() + 1, 0);
+          ssize_t bytes = ::readlinkat(dirfd, i.path.c_str(), &target[0], target.size());
+          return bytes >= 0 && static_cast<size_t>(bytes) == i.target.size() && 0 == target.compare(0, i.target.size(), i.target);
+        }
+        case entry_type::file:
+          break;
+        }
+        if(static_cast<uint64_t>(st.st_size) != i.size)
+          return false;
+        if(!i.inlined)
+        {
+          const struct timespec mtime = _mtime_of(st);
+          return mtime.tv_sec == i.mtime.tv_sec && mtime.tv_nsec == i.mtime.tv_nsec;
+        }
+        // Small files are compared in full, as a write within the timestamp granularity of the filesystem may not change the modification time
+        int fd = ::openat(dirfd, i.path.c_str(), O_RDONLY | O_CLOEXEC);
+        if(fd < 0)
+          return false;
+        char buffer[16384];
+        size_t offset = 0;
+        for(;;)
+        {
+          ssize_t bytes = ::read(fd, buffer, sizeof(buffer));
+          if(bytes <= 0)
+          {
+            ::close(fd);
+            return bytes == 0 && offset == i.contents.size();
+          }
+          if(offset + static_cast<size_t>(bytes) > i.contents.size() || 0 != i.contents.compare(offset, static_cast<size_t>(bytes), buffer, static_cast<size_t>(bytes)))
+          {
+            ::close(fd);
+            return false;
+          }
+          offset += static_cast<size_t>(bytes);
+        }
+      }
+      // Removes everything inside dir which the template does not have, or has as something of another type
+      void _prune(const filesystem::path &dir, const std::string &prefix, std::error_code &ec) const
+      {
+        std::vector<filesystem::path> unwanted;
+        for(filesystem::directory_iterator it(dir, ec); !ec && it != filesystem::directory_iterator(); it.increment(ec))
+        {
+          const std::string path(prefix + it->path().filename().string());
+          struct stat st;
+          if(::lstat(it->path().c_str(), &st) < 0)
+          {
+            ec = std::error_code(errno, std::system_category());
+            return;
+          }
+          entry_type type;
+          auto found = _index.find(path);
+          if(found == _index.end() || !_type_of(st, type) || type != _entries[found->second].type)
+            unwanted.push_back(it->path());
+          else if(type == entry_type::directory)
+          {
+            _prune(it->path(), path + "/", ec);
+            if(ec)
+              return;
+          }
+        }
+        if(ec)
+          return;
+        for(const auto &i : unwanted)
+        {
+          filesystem::remove_all(i, ec);
+          if(ec)
+            return;
+        }
+      }
+
+    public:
+      //! Walks the template at source, which need not exist
+      template_manifest(filesystem::path source, std::error_code &ec)
+          : _source(std::move(source))
+      {
+        bool exists = filesystem::exists(_source, ec);
+        if(ec && ec != std::errc::no_such_file_or_directory)
+          return;
+        ec.clear();
+        if(exists)
+          _scan(_source, std::string(), ec);
+      }
+      //! Returns the manifest of the template at source, walking it if this process has not already done so
+      static std::shared_ptr<const template_manifest> get(const filesystem::path &source, std::error_code &ec)
+      {
+        static std::mutex lock;
+        static std::unordered_map<filesystem::path, std::shared_ptr<const template_manifest>, path_hasher> manifests;
+        std::lock_guard<std::mutex> g(lock);
+        auto it = manifests.find(source);
+        if(it != manifests.end())
+          return it->second;
+        auto ret = std::make_shared<const template_manifest>(source, ec);
+        if(ec)
+          return nullptr;
+        manifests.emplace(source, ret);
+        return ret;
+      }
+
+      //! The template this is a snapshot of
+      const filesystem::path &source() const noexcept { return _source; }
+      //! The items of the template, parents before children
+      const std::vector<entry> &entries() const noexcept { return _entries; }
+
+      //! Materialises the template into the existing empty directory dest, cloning big files as clone says
+      void materialise(const filesystem::path &dest, workspace_clone clone, std::error_code &ec) const
+      {
+        int dirfd = ::open(dest.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if(dirfd < 0)
+        {
+          ec = std::error_code(errno, std::system_category());
+          return;
+        }
+        for(const entry &i : _entries)
+        {
+          _create(dirfd, dest, i, clone, ec);
+          if(ec)
+            break;
+        }
+        if(!ec)
+          _set_directory_modes(dirfd, ec);
+        ::close(dirfd);
+      }
+      /*! Returns the directory dest, which was materialised from this manifest, to how `materialise()` left it,
+      touching only what differs from the template. Items the template doesn't have are removed, and items which
+      are missing, or whose type, permissions, size, symlink target, or contents differ, are created again. The
+      contents of files bigger than `inline_limit` are assumed unchanged if their size and modification time are.
+      */
+      void recycle(const filesystem::path &dest, workspace_clone clone, std::error_code &ec) const
+      {
+        int dirfd = ::open(dest.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if(dirfd < 0)
+        {
+          ec = std::error_code(errno, std::system_category());
+          return;
+        }
+        // Directories are made writable while what is inside them is restored, as with materialise()
+        for(const entry &i : _entries)
+        {
+          struct stat st;
+          if(i.type != entry_type::directory || ::fstatat(dirfd, i.path.c_str(), &st, AT_SYMLINK_NOFOLLOW) < 0 || !S_ISDIR(st.st_mode) || (st.st_mode & 0700) == 0700)
+            continue;
+          if(::fchmodat(dirfd, i.path.c_str(), (static_cast<unsigned>(st.st_mode) & 07777) | 0700, 0) < 0)
+          {
+            ec = std::error_code(errno, std::system_category());
+            ::close(dirfd);
+            return;
+          }
+        }
+        _prune(dest, std::string(), ec);
+        if(ec)
+        {
+          ::close(dirfd);
+          return;
+        }
+        for(const entry &i : _entries)
+        {
+          struct stat st;
+          if(::fstatat(dirfd, i.path.c_str(), &st, AT_SYMLINK_NOFOLLOW) == 0)
+          {
+            // Only the permissions of a directory can differ, as _prune() removed it if it wasn't one, and
+            // those are set by _set_directory_modes() below
+            if(i.type == entry_type::directory || _matches(dirfd, i, st))
+              continue;
+            if(::unlinkat(dirfd, i.path.c_str(), 0) < 0)
+            {
+              ec = std::error_code(errno, std::system_category());
+              break;
+            }
+          }
+          else if(errno != ENOENT)
+          {
+            ec = std::error_code(errno, std::system_category());
+            break;
+          }
+          _create(dirfd, dest, i, clone, ec);
+          if(ec)
+            break;
+        }
+        if(!ec)
+          _set_directory_modes(dirfd, ec);
+        ::close(dirfd);
+      }
+    };
+#endif
+
+#ifndef _WIN32
+    // The process which started the program, rather than a child forked from it
+    template <class T = void> struct initial_process
+    {
+      static const pid_t id;
+    };
+    template <class T> const pid_t initial_process<T>::id = getpid();
+#endif
+
+#ifndef _WIN32
+    // Gives the owner full access to the directory at path and every directory inside it, so what is in them can be deleted
+    inline void make_directories_writable(const filesystem::path &path)
+    {
+      struct stat st;
+      if(::lstat(path.c_str(), &st) < 0 || !S_ISDIR(st.st_mode))
+        return;
+      if((st.st_mode & 0700) != 0700)
+        ::chmod(path.c_str(), (static_cast<unsigned>(st.st_mode) & 07777) | 0700);
+      std::error_code ec;
+      for(filesystem::directory_iterator it(path, ec); !ec && it != filesystem::directory_iterator(); it.increment(ec))
+        make_directories_writable(it->path());
+    }
+#endif
+
+    //! Deletes the workspace at path, trying for up to five seconds, returning false with ec set if it couldn't
+    inline bool remove_workspace(const filesystem::path &path, std::error_code &ec)
+    {
+      auto begin = std::chrono::steady_clock::now();
+      do
+      {
+        ec.clear();
+        bool exists = filesystem::exists(path, ec);
+        if(!exists && (!ec || ec == std::errc::no_such_file_or_directory))
+          return true;
+        filesystem::remove_all(path, ec);
+#ifndef _WIN32
+        // Workspaces materialised from templates with read only directories have them too
+        if(ec == std::errc::permission_denied)
+          make_directories_writable(path);
+#endif
+      } while(std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - begin).count() < 5);
+      return false;
+    }
+
+    /* Deletes the workspaces torn down by every thread on a thread of its own, so the next permutation need
+    not wait for the previous workspace to be deleted. Each workspace is renamed into the trash directory of
+    this process first, which frees its name at once. The trash is emptied and removed at process exit.
+    */
+    class workspace_reaper
+    {
+      filesystem::path _trash;
+      std::mutex _lock;
+      std::condition_variable _changed;
+      std::vector<filesystem::path> _queue;
+      size_t _retired{0};
+      bool _stop{false};
+      std::thread _thread;
+
+      void _run()
+      {
+        std::unique_lock<std::mutex> g(_lock);
+        for(;;)
+        {
+          _changed.wait(g, [&] { return !_queue.empty() || _stop; });
+          if(_queue.empty())
+            return;
+          filesystem::path path(std::move(_queue.back()));
+          _queue.pop_back();
+          g.unlock();
+          std::error_code ec;
+          if(!remove_workspace(path, ec))
+          {
+            KERNELTEST_CERR("WARNING: Couldn't delete " << path << " due to " << ec.message() << " after five seconds of trying." << std::endl);
+          }
+          g.lock();
+        }
+      }
+
+    public:
+      workspace_reaper()
+#ifndef _WIN32
+          : _trash(starting_path() / ("kerneltest_trash_" + std::to_string(getpid())))
+#else
+          : _trash(starting_path() / ("kerneltest_trash_" + std::to_string(GetCurrentProcessId())))
+#endif
+      {
+      }
+      workspace_reaper(const workspace_reaper &) = delete;
+      workspace_reaper &operator=(const workspace_reaper &) = delete;
+      ~workspace_reaper()
+      {
+        if(!_thread.joinable())
+          return;
+        {
+          std::lock_guard<std::mutex> g(_lock);
+          _stop = true;
+        }
+        _changed.notify_all();
+        _thread.join();
+        std::error_code ec;
+        filesystem::remove(_trash, ec);
+      }
+      //! The reaper of this process, or null in a forked child, which could exit without waiting for it
+      static workspace_reaper *get()
+      {
+#ifndef _WIN32
+        if(initial_process<>::id != getpid())
+          return nullptr;
+#endif
+        static workspace_reaper v;
+        return &v;
+      }
+      //! Renames the workspace at path into the trash and queues it for deletion, returning false if it couldn't be renamed
+      bool retire(const filesystem::path &path)
+      {
+        std::lock_guard<std::mutex> g(_lock);
+        std::error_code ec;
+        if(!_thread.joinable())
+        {
+          filesystem::create_directory(_trash, ec);
+          if(ec)
+            return false;
+          _thread = std::thread([this] { _run(); });
+        }
+        filesystem::path dest(_trash / std::to_string(_retired++));
+        filesystem::rename(path, dest, ec);
+        if(ec)
+          return false;
+        _queue.push_back(std::move(dest));
+        _changed.notify_one();
+        return true;
+      }
+    };
+
+    // Deletes the workspace at path by the reaper if possible, returning false with ec set if it couldn't be deleted
+    inline bool discard_workspace(const filesystem::path &path, std::error_code &ec)
+    {
+      workspace_reaper *reaper = workspace_reaper::get();
+      if(reaper != nullptr && reaper->retire(path))
+        return true;
+      return remove_workspace(path, ec);
+    }
+
+#ifndef _WIN32
+    /* The workspace kept by the calling thread for the next permutation it executes to recycle, which is
+    deleted when the thread exits. It is forgotten while a permutation uses it, so a workspace abandoned
+    mid permutation, for example by a signal, is materialised afresh rather than recycled.
+    */
+    struct recycled_workspace
+    {
+      filesystem::path path;
+      std::shared_ptr<const template_manifest> manifest;
+
+      recycled_workspace() = default;
+      recycled_workspace(const recycled_workspace &) = delete;
+      recycled_workspace &operator=(const recycled_workspace &) = delete;
+      ~recycled_workspace()
+      {
+        if(manifest)
+        {
+          std::error_code ec;
+          if(!discard_workspace(path, ec))
+          {
+            KERNELTEST_CERR("WARNING: Couldn't delete " << path << " due to " << ec.message() << " after five seconds of trying." << std::endl);
+          }
+        }
+      }
+      //! The workspace of the calling thread, or null in a forked child, whose thread locals are never destroyed
+      static recycled_workspace *get()
+      {
+        if(initial_process<>::id != getpid())
+          return nullptr;
+        static thread_local recycled_workspace v;
+        return &v;
+      }
+    };
+#endif
+
     template <bool is_throwing, class Parent, class RetType> struct impl
     {
       filesystem::path _current;
+      workspace_mode _mode{workspace_mode::working_directory};
+#ifndef _WIN32
+      int _fd{-1};
+      std::shared_ptr<const template_manifest> _recycle;  // The manifest of the workspace if it is to be recycled
+#endif
 
       void _remove_workspace()  // noexcept(!is_throwing)
       {
         std::error_code ec;
-        auto begin = std::chrono::steady_clock::now();
-        do
-        {
-          ec.clear();
-          bool exists = filesystem::exists(_current, ec);
-          if(!exists && (!ec || ec == std::errc::no_such_file_or_directory))
-            return;
-          filesystem::remove_all(_current, ec);
-        } while(std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - begin).count() < 5);
+        if(remove_workspace(_current, ec))
+          return;
         if(is_throwing)
           throw std::runtime_error("Couldn't delete workspace after five seconds of trying");
         KERNELTEST_CERR("FATAL: Couldn't delete " << _current << " due to " << ec.message() << " after five seconds of trying." << std::endl);
         std::terminate();
       }
 
-      impl(Parent *, RetType &, size_t, filesystem::path &&workspace)  // noexcept(!is_throwing)
+      impl(Parent *parent, RetType &testret, size_t idx, filesystem::path &&workspace, workspace_clone clone = workspace_clone::automatic, workspace_mode mode = workspace_mode::working_directory, workspace_teardown teardown = workspace_teardown::remove)  // noexcept(!is_throwing)
+          : impl(parent, testret, idx, cached_workspace_template_path<is_throwing>(workspace), std::true_type(), clone, mode, teardown)
+      {
+      }
+      impl(Parent *, RetType &, size_t, const filesystem::path &template_path, std::true_type /*is template path*/, workspace_clone clone = workspace_clone::automatic, workspace_mode mode = workspace_mode::working_directory, workspace_teardown teardown = workspace_teardown::remove)  // noexcept(!is_throwing)
+          : _mode(mode)
       {
-        auto template_path = workspace_template_path<is_throwing>(workspace);
         // Make the workspace we choose unique to this thread
         _current = starting_path() / ("kerneltest_workspace_" + std::to_string(QUICKCPPLIB_NAMESPACE::utils::thread::this_thread_id()));
-        // Clear out any stale workspace with the same name at this path just in case
-        _remove_workspace();
 
         std::error_code ec;
         auto fatalexit = [&] {
@@ -250,6 +946,45 @@ namespace hooks
           KERNELTEST_CERR("FATAL: Couldn't copy " << template_path << " to " << _current << " due to " << ec.message() << " after five seconds of trying." << std::endl);
           std::terminate();
         };
+#ifndef _WIN32
+        // The template is only walked the first time this process uses it
+        std::shared_ptr<const template_manifest> manifest = template_manifest::get(template_path, ec);
+        if(!manifest)
+          fatalexit();
+        bool recycled = false;
+        recycled_workspace *previous = (teardown == workspace_teardown::recycle) ? recycled_workspace::get() : nullptr;
+        if(previous != nullptr)
+        {
+          // Only what the previous permutation on this thread changed is restored
+          if(previous->manifest == manifest && previous->path == _current)
+          {
+            manifest->recycle(_current, clone, ec);
+            recycled = !ec;
+            ec.clear();
+          }
+          previous->manifest.reset();
+          _recycle = manifest;
+        }
+        // Clear out any stale workspace with the same name at this path just in case
+        if(!recycled)
+          _remove_workspace();
+        auto begin = std::chrono::steady_clock::now();
+        while(!recycled)
+        {
+          filesystem::create_directory(_current, ec);
+          if(!ec)
+            manifest->materialise(_current, clone, ec);
+          if(!ec)
+            break;
+          // Start again from nothing
+          _remove_workspace();
+          if(std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - begin).count() >= 5)
+            fatalexit();
+        }
+#else
+        (void) teardown;
+        // Clear out any stale workspace with the same name at this path just in case
+        _remove_workspace();
         // Is the input workspace no workspace? In which case create an empty directory
         bool exists = filesystem::exists(template_path, ec);
         if(ec && ec != std::errc::no_such_file_or_directory)
@@ -268,11 +1003,10 @@ namespace hooks
             // VS2017 still doesn't understand symlinks :(, so copy in the starting filesystem environment by hand
             struct _
             {
-              static void copy_level(const filesystem::path &srcdir, const filesystem::path &destdir, std::error_code &ec)
+              static void copy_level(const filesystem::path &srcdir, const filesystem::path &destdir, workspace_clone &strategy, std::error_code &ec)
               {
                 for(filesystem::directory_iterator it(srcdir); it != filesystem::directory_iterator(); ++it)
                 {
-#ifdef _WIN32
                   typedef struct _REPARSE_DATA_BUFFER  // NOLINT
                   {
                     ULONG ReparseTag;
@@ -333,25 +1067,17 @@ namespace hooks
                   CloseHandle(h);
                   if(is_symlink)
                     continue;
-#else
-                  if(filesystem::is_symlink(it->status()))
-                  {
-                    filesystem::copy_symlink(it->path(), destdir / it->path().filename(), ec);
-                    if(ec)
-                      return;
-                  }
-#endif
                   else if(filesystem::is_directory(it->status()))
                   {
                     filesystem::create_directory(destdir / it->path().filename(), ec);
                     ec.clear();
-                    copy_level(it->path(), destdir / it->path().filename(), ec);
+                    copy_level(it->path(), destdir / it->path().filename(), strategy, ec);
                     if(ec)
                       return;
                   }
                   else if(filesystem::is_regular_file(it->status()))
                   {
-                    filesystem::copy_file(it->path(), destdir / it->path().filename(), ec);
+                    clone_file(it->path(), destdir / it->path().filename(), strategy, ec);
                     if(ec)
                       return;
                   }
@@ -360,33 +1086,98 @@ namespace hooks
             };
             filesystem::create_directory(_current, ec);
             ec.clear();
-            _::copy_level(template_path, _current, ec);
+            _::copy_level(template_path, _current, clone, ec);
             if(!ec)
               break;
           } while(std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - begin).count() < 5);
           if(ec)
             fatalexit();
         }
+#endif
+#ifndef _WIN32
+#ifdef O_PATH
+        _fd = ::open(_current.c_str(), O_PATH | O_DIRECTORY | O_CLOEXEC);
+#else
+        _fd = ::open(_current.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+#endif
+        if(_fd < 0)
+        {
+          ec = std::error_code(errno, std::system_category());
+          fatalexit();
+        }
+        current_test_kernel.working_directory_fd = _fd;
+#endif
         // Set the working directory to the newly configured workspace
-        filesystem::current_path(_current);
+        if(_mode == workspace_mode::working_directory)
+          filesystem::current_path(_current);
         current_test_kernel.working_directory = _current.c_str();
       }
-      constexpr impl(impl &&) noexcept = default;
+      impl(impl &&o) noexcept
+          : _current(std::move(o._current))
+          , _mode(o._mode)
+#ifndef _WIN32
+          , _fd(o._fd)
+          , _recycle(std::move(o._recycle))
+#endif
+      {
+        o._current.clear();
+#ifndef _WIN32
+        o._fd = -1;
+#endif
+      }
       impl(const impl &) = delete;
       ~impl() noexcept(!is_throwing)
       {
         if(!_current.empty())
         {
           current_test_kernel.working_directory = nullptr;
-          filesystem::current_path(starting_path());
-          _remove_workspace();
+#ifndef _WIN32
+          ::close(_fd);
+          current_test_kernel.working_directory_fd = -1;
+#endif
+          if(_mode == workspace_mode::working_directory)
+            filesystem::current_path(starting_path());
+#ifndef _WIN32
+          if(_recycle)
+          {
+            // Kept for the next permutation on this thread to recycle
+            recycled_workspace *next = recycled_workspace::get();
+            next->path = std::move(_current);
+            next->manifest = std::move(_recycle);
+            return;
+          }
+#endif
+          // Deleting the workspace is left to the reaper if possible
+          workspace_reaper *reaper = workspace_reaper::get();
+          if(reaper == nullptr || !reaper->retire(_current))
+            _remove_workspace();
         }
       }
     };
+    // Kept by each worker, so the template of each workspace is only looked for once
+    template <bool is_throwing> struct setup_session
+    {
+      const char *workspacebase;
+      workspace_clone clone;
+      workspace_mode mode;
+      workspace_teardown teardown;
+      std::unordered_map<std::string, filesystem::path> templates;
+      template <class Parent, class RetType> auto operator()(Parent *parent, RetType &testret, size_t idx, const char *workspace)
+      {
+        auto it = templates.find(workspace);
+        if(it == templates.end())
+          it = templates.emplace(workspace, cached_workspace_template_path<is_throwing>(filesystem::path(workspacebase) / workspace)).first;
+        return impl<is_throwing, Parent, RetType>(parent, testret, idx, it->second, std::true_type(), clone, mode, teardown);
+      }
+    };
     template <bool is_throwing> struct inst
     {
       const char *workspacebase;
-      template <class Parent, class RetType> auto operator()(Parent *parent, RetType &testret, size_t idx, const char *workspace) const { return impl<is_throwing, Parent, RetType>(parent, testret, idx, filesystem::path(workspacebase) / workspace); }
+      workspace_clone clone;
+      workspace_mode mode;
+      workspace_teardown teardown;
+      template <class Parent, class RetType> auto operator()(Parent *parent, RetType &testret, size_t idx, const char *workspace) const { return impl<is_throwing, Parent, RetType>(parent, testret, idx, filesystem::path(workspacebase) / workspace, clone, mode, teardown); }
+      setup_session<is_throwing> session() const { return {workspacebase, clone, mode, teardown, {}}; }
       std::string print(const char *workspace) const { return std::string("precondition ") + workspace; }
     };
   }
@@ -395,18 +1186,26 @@ namespace hooks
   /*! Kernel test hook setting up a workspace directory for the test to run inside and deleting it after.
 
   The working directory on first instantiation is assumed to be the correct place to put test workspaces
-  each of which will be named after the unique thread id of the calling thread.
+  each of which will be named after the unique thread id of the calling thread. Workspaces torn down are
+  renamed into a `kerneltest_trash_<pid>` directory there, and deleted by a background thread, which is
+  waited for when the process exits. If they cannot be renamed they are deleted before teardown returns.
   The source of the workspace templates comes from `workspace_template_path()` which in turn derives from
   `library_directory()`.
   \tparam is_throwing If true, throw exceptions for any errors encountered,
   else print a useful message to KERNELTEST_CERR() and terminate the
   process.
-  \return A type which when called configures the workspace and changes the working directory to that
-  workspace, and on destruction deletes the workspace and changes the working directory back to `starting_path()`.
-  `current_test_kernel.working_directory` is also set to the working directory.
+  \return A type which when called configures the workspace and, unless `mode` is `workspace_mode::directory_fd`,
+  changes the working directory to that workspace, and on destruction deletes the workspace and changes the working
+  directory back to `starting_path()`. `current_test_kernel.working_directory` is also set to the workspace, and on
+  POSIX `current_test_kernel.working_directory_fd` to a file descriptor of it.
   \param workspacebase A path fragment inside `test/tests` of the base of the workspaces to choose from.
+  \param clone How the files of the workspace template are cloned into each workspace.
+  \param mode Whether the working directory is changed to the workspace, which must not be the case if the
+  permuter is multithreaded.
+  \param teardown Whether each workspace is deleted after the kernel, or kept to be restored to the template by
+  the next permutation on the same thread.
   */
-  template <bool is_throwing = false> constexpr inline auto filesystem_setup(const char *workspacebase = current_test_kernel.test) { return filesystem_setup_impl::inst<is_throwing>{workspacebase}; }
+  template <bool is_throwing = false> constexpr inline auto filesystem_setup(const char *workspacebase = current_test_kernel.test, workspace_clone clone = workspace_clone::automatic, workspace_mode mode = workspace_mode::working_directory, workspace_teardown teardown = workspace_teardown::remove) { return filesystem_setup_impl::inst<is_throwing>{workspacebase, clone, mode, teardown}; }
 
   namespace filesystem_comparison_impl
   {
@@ -623,11 +1422,11 @@ namespace hooks
       RetType &testret;
       size_t idx;
       filesystem::path model_workspace;
-      structure_impl(Parent *_parent, RetType &_testret, size_t _idx, const char *workspacebase, const char *workspace)
+      structure_impl(Parent *_parent, RetType &_testret, size_t _idx, filesystem::path _model_workspace)
           : parent(_parent)
           , testret(_testret)
           , idx(_idx)
-          , model_workspace(filesystem_setup_impl::workspace_template_path(filesystem::path(workspacebase) / workspace))
+          , model_workspace(std::move(_model_workspace))
       {
       }
       structure_impl(structure_impl &&) noexcept = default;
@@ -661,10 +1460,24 @@ namespace hooks
         }
       }
     };
+    // Kept by each worker, so the template of each workspace is only looked for once
+    struct structure_session
+    {
+      const char *workspacebase;
+      std::unordered_map<std::string, filesystem::path> templates;
+      template <class Parent, class RetType> auto operator()(Parent *parent, RetType &testret, size_t idx, const char *workspace)
+      {
+        auto it = templates.find(workspace);
+        if(it == templates.end())
+          it = templates.emplace(workspace, filesystem_setup_impl::cached_workspace_template_path(filesystem::path(workspacebase) / workspace)).first;
+        return structure_impl<Parent, RetType>(parent, testret, idx, it->second);
+      }
+    };
     struct structure_inst
     {
       const char *workspacebase;
-      template <class Parent, class RetType> auto operator()(Parent *parent, RetType &testret, size_t idx, const char *workspace) const { return structure_impl<Parent, RetType>(parent, testret, idx, workspacebase, workspace); }
+      template <class Parent, class RetType> auto operator()(Parent *parent, RetType &testret, size_t idx, const char *workspace) const { return structure_impl<Parent, RetType>(parent, testret, idx, filesystem_setup_impl::cached_workspace_template_path(filesystem::path(workspacebase) / workspace)); }
+      structure_session session() const { return {workspacebase, {}}; }
       std::string print(const char *workspace) const { return std::string("postcondition ") + workspace; }
     };
   }
@@ -0,0 +1,307 @@
+/* Heap allocation accounting test kernel hook
+(C) 2026 agent <agent@local>
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#include "../config.hpp"
+
+#ifndef KERNELTEST_HOOKS_HEAP_ACCOUNTING_HPP
+#define KERNELTEST_HOOKS_HEAP_ACCOUNTING_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+
+KERNELTEST_V1_NAMESPACE_BEGIN
+
+namespace hooks
+{
+  //! The heap usage of a permutation on the thread executing it
+  struct heap_usage
+  {
+    uint64_t allocations{0};    //!< The number of calls of `operator new`
+    uint64_t bytes{0};          //!< The bytes requested by those calls
+    uint64_t peak_bytes{0};     //!< The most bytes allocated by the permutation live at once
+    uint64_t leaked{0};         //!< The number of those allocations not freed by the end of teardown
+    uint64_t leaked_bytes{0};   //!< The bytes of those allocations not freed by the end of teardown
+    size_t budget{(size_t) -1};  //!< The allocation budget of the permutation
+  };
+  //! An allocation budget meaning the permutation may allocate as often as it likes
+  static constexpr size_t unlimited_allocations = (size_t) -1;
+
+  //! Returns the printed form of some heap usage
+  inline std::string print(const heap_usage &v)
+  {
+    std::ostringstream s;
+    s << v.allocations << " allocations of " << v.bytes << " bytes, peak " << v.peak_bytes << " bytes live";
+    if(v.leaked > 0)
+      s << ", " << v.leaked << " allocations of " << v.leaked_bytes << " bytes leaked";
+    if(v.budget != unlimited_allocations)
+      s << ", allocation budget is " << v.budget;
+    return s.str();
+  }
+
+  namespace heap_accounting_impl
+  {
+    /* The accounting of the calling thread. Every block allocated by the replaced operator new is
+    prefixed with its size and the token of the accounting active on the allocating thread, if any,
+    so frees of blocks allocated before the permutation began, or by another permutation, are ignored.
+    This is deliberately trivially constructible, as it is touched from inside operator new.
+    */
+    struct thread_state
+    {
+      uint64_t token;
+      uint64_t allocations, bytes, live, live_allocations, peak;
+    };
+    inline thread_state &state() noexcept
+    {
+      static QUICKCPPLIB_THREAD_LOCAL thread_state v;
+      return v;
+    }
+    // Set by the replaced operator new during static initialisation
+    inline std::atomic<bool> &operator_new_replaced() noexcept
+    {
+      static std::atomic<bool> v(false);
+      return v;
+    }
+
+    struct block_header
+    {
+      size_t size;
+      uint64_t token;
+    };
+    static constexpr size_t header_size = (sizeof(block_header) + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+
+    // Called by the replaced operator new with a freshly allocated block, returning what the caller gets
+    inline void *on_allocate(void *block, size_t size) noexcept
+    {
+      thread_state &s = state();
+      auto *h = static_cast<block_header *>(block);
+      h->size = size;
+      h->token = s.token;
+      if(s.token != 0)
+      {
+        s.allocations++;
+        s.bytes += size;
+        s.live += size;
+        s.live_allocations++;
+        if(s.live > s.peak)
+          s.peak = s.live;
+      }
+      return static_cast<char *>(block) + header_size;
+    }
+    // Called by the replaced operator delete, returning the block to free
+    inline void *on_free(void *p) noexcept
+    {
+      auto *h = reinterpret_cast<block_header *>(static_cast<char *>(p) - header_size);
+      thread_state &s = state();
+      if(h->token != 0 && h->token == s.token)
+      {
+        s.live -= h->size;
+        s.live_allocations--;
+      }
+      return h;
+    }
+
+    struct usage_table
+    {
+      std::mutex lock;
+      std::unordered_map<size_t, heap_usage> v;
+    };
+    template <class RetType> struct impl
+    {
+      RetType *testret;
+      size_t idx;
+      size_t budget;
+      bool check_leaks;
+      usage_table *table;
+      thread_state saved;
+
+      impl(RetType &_testret, size_t _idx, size_t _budget, bool _check_leaks, usage_table *_table)
+          : testret(&_testret)
+          , idx(_idx)
+          , budget(_budget)
+          , check_leaks(_check_leaks)
+          , table(_table)
+          , saved(state())
+      {
+        static std::atomic<uint64_t> tokens(0);
+        thread_state &s = state();
+        s = thread_state();
+        s.token = ++tokens;
+      }
+      impl(impl &&o) noexcept : testret(o.testret), idx(o.idx), budget(o.budget), check_leaks(o.check_leaks), table(o.table), saved(o.saved) { o.testret = nullptr; }
+      impl(const impl &) = delete;
+      ~impl()
+      {
+        if(testret == nullptr)
+          return;
+        // Restore any accounting this permutation interrupted
+        thread_state &s = state();
+        const thread_state mine = s;
+        s = saved;
+        heap_usage usage;
+        usage.allocations = mine.allocations;
+        usage.bytes = mine.bytes;
+        usage.peak_bytes = mine.peak;
+        usage.leaked = mine.live_allocations;
+        usage.leaked_bytes = mine.live;
+        usage.budget = budget;
+        {
+          std::lock_guard<std::mutex> g(table->lock);
+          table->v[idx] = usage;
+        }
+        // Only fail kernels which otherwise succeeded
+        if(*testret && **testret)
+        {
+          if(check_leaks && usage.leaked > 0)
+            *testret = RetType(typename RetType::value_type::error_type(make_error_code(kerneltest_errc::allocations_leaked)));
+          else if(budget != unlimited_allocations && usage.allocations > budget)
+            *testret = RetType(typename RetType::value_type::error_type(make_error_code(kerneltest_errc::allocation_budget_exceeded)));
+        }
+      }
+    };
+    // Instantiated during permuter construction
+    struct inst
+    {
+      bool check_leaks;
+      std::shared_ptr<usage_table> _usage;
+
+      template <class Parent, class RetType> auto operator()(Parent * /*unused*/, RetType &testret, size_t idx, size_t budget) const
+      {
+        if(!operator_new_replaced())
+        {
+          static std::atomic<bool> warned(false);
+          if(!warned.exchange(true))
+          {
+            detail::log_capture_suspended uncaptured;
+            KERNELTEST_CERR("WARNING: hooks::heap_accounting cannot count anything as no translation unit defined KERNELTEST_REPLACE_OPERATOR_NEW before including it" << std::endl);
+          }
+        }
+        return impl<RetType>(testret, idx, budget, check_leaks, _usage.get());
+      }
+      std::string print(size_t budget) const
+      {
+        if(budget == unlimited_allocations)
+          return "heap accounting";
+        return "allocation budget of " + std::to_string(budget);
+      }
+
+      //! Returns true and fills in out if the permutation at idx has been executed by this process
+      bool usage(size_t idx, heap_usage &out) const
+      {
+        std::lock_guard<std::mutex> g(_usage->lock);
+        auto it = _usage->v.find(idx);
+        if(it == _usage->v.end())
+          return false;
+        out = it->second;
+        return true;
+      }
+    };
+  }  // namespace heap_accounting_impl
+  //! The parameters for the heap accounting hook, being the most allocations the permutation may make
+  using heap_accounting_parameters = parameters<size_t>;
+  /*! Kernel test hook counting the calls of `operator new` made on the thread executing a permutation
+  between the construction and destruction of this hook, the bytes they requested, and the most of those
+  bytes live at once. A permutation whose kernel succeeded is failed with `kerneltest_errc::allocations_leaked`
+  if any of its allocations were not freed by the end of teardown, unless `check_leaks` is false, and with
+  `kerneltest_errc::allocation_budget_exceeded` if it allocated more times than its row allows.
+
+  Place this hook first in the hook sequence, so it is constructed before and destroyed after the other hooks,
+  and so accounts for their setup and teardown as well as for the kernel. Note that a kernel returning a value
+  which owns heap memory has leaked that memory as far as this hook is concerned.
+
+  Exactly one translation unit of the test program must `#define KERNELTEST_REPLACE_OPERATOR_NEW` before
+  including KernelTest, which defines the replaceable global `operator new` and `operator delete`. Allocations
+  by `malloc()`, by over-aligned `operator new`, and by threads started by the kernel are not counted.
+  */
+  inline heap_accounting_impl::inst heap_accounting(bool check_leaks = true) { return heap_accounting_impl::inst{check_leaks, std::make_shared<heap_accounting_impl::usage_table>()}; }
+}  // namespace hooks
+
+KERNELTEST_V1_NAMESPACE_END
+
+#endif
+
+#if defined(KERNELTEST_REPLACE_OPERATOR_NEW) && !defined(KERNELTEST_OPERATOR_NEW_REPLACED)
+#define KERNELTEST_OPERATOR_NEW_REPLACED
+
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+  const bool kerneltest_operator_new_replaced = (KERNELTEST_V1_NAMESPACE::hooks::heap_accounting_impl::operator_new_replaced() = true);
+}
+
+void *operator new(size_t size)
+{
+  void *block = malloc(KERNELTEST_V1_NAMESPACE::hooks::heap_accounting_impl::header_size + size);
+  if(block == nullptr)
+    throw std::bad_alloc();
+  return KERNELTEST_V1_NAMESPACE::hooks::heap_accounting_impl::on_allocate(block, size);
+}
+void *operator new[](size_t size)
+{
+  return ::operator new(size);
+}
+void *operator new(size_t size, const std::nothrow_t &) noexcept
+{
+  void *block = malloc(KERNELTEST_V1_NAMESPACE::hooks::heap_accounting_impl::header_size + size);
+  if(block == nullptr)
+    return nullptr;
+  return KERNELTEST_V1_NAMESPACE::hooks::heap_accounting_impl::on_allocate(block, size);
+}
+void *operator new[](size_t size, const std::nothrow_t &t) noexcept
+{
+  return ::operator new(size, t);
+}
+void operator delete(void *p) noexcept
+{
+  if(p != nullptr)
+    free(KERNELTEST_V1_NAMESPACE::hooks::heap_accounting_impl::on_free(p));
+}
+void operator delete[](void *p) noexcept
+{
+  ::operator delete(p);
+}
+void operator delete(void *p, const std::nothrow_t &) noexcept
+{
+  ::operator delete(p);
+}
+void operator delete[](void *p, const std::nothrow_t &) noexcept
+{
+  ::operator delete(p);
+}
+void operator delete(void *p, size_t) noexcept
+{
+  ::operator delete(p);
+}
+void operator delete[](void *p, size_t) noexcept
+{
+  ::operator delete(p);
+}
+#endif
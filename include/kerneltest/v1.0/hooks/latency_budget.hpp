@@ -0,0 +1,103 @@
+/* Latency budget test kernel hook
+(C) 2026 agent <agent@local>
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#include "../config.hpp"
+
+#ifndef KERNELTEST_HOOKS_LATENCY_BUDGET_HPP
+#define KERNELTEST_HOOKS_LATENCY_BUDGET_HPP
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+KERNELTEST_V1_NAMESPACE_BEGIN
+
+namespace hooks
+{
+  //! How long a kernel took, and how long its latency budget allowed it
+  struct latency_budget_overrun
+  {
+    std::chrono::nanoseconds took;    //!< The fastest of the measurements of the kernel
+    std::chrono::nanoseconds budget;  //!< The latency budget of the permutation
+  };
+
+  namespace latency_budget_impl
+  {
+    struct overruns
+    {
+      std::mutex lock;
+      std::unordered_map<size_t, latency_budget_overrun> v;
+    };
+    // Instantiated during permuter construction
+    struct inst
+    {
+      size_t remeasurements;
+      std::shared_ptr<overruns> _overruns;
+
+      // Called at the beginning of an individual test. The permuter does the timing around the kernel.
+      template <class Parent, class RetType> int operator()(Parent * /*unused*/, RetType & /*unused*/, size_t /*unused*/, std::chrono::nanoseconds /*unused*/) const { return 0; }
+      std::string print(std::chrono::nanoseconds budget) const
+      {
+        if(budget.count() == 0)
+          return "no latency budget";
+        return "latency budget of " + std::to_string(budget.count()) + " ns";
+      }
+
+      //! Records that the permutation at idx overran its budget, or forgets it if it didn't
+      void record(size_t idx, const latency_budget_overrun *overrun) const
+      {
+        std::lock_guard<std::mutex> g(_overruns->lock);
+        if(overrun != nullptr)
+          _overruns->v[idx] = *overrun;
+        else
+          _overruns->v.erase(idx);
+      }
+      //! Returns true and fills in overrun if the permutation at idx overran its budget when last run in this process
+      bool overran(size_t idx, latency_budget_overrun &overrun) const
+      {
+        std::lock_guard<std::mutex> g(_overruns->lock);
+        auto it = _overruns->v.find(idx);
+        if(it == _overruns->v.end())
+          return false;
+        overrun = it->second;
+        return true;
+      }
+    };
+  }  // namespace latency_budget_impl
+  //! The parameters for the latency budget hook, being the budget of the kernel, zero meaning unlimited
+  using latency_budget_parameters = parameters<std::chrono::nanoseconds>;
+  /*! Kernel test hook failing a kernel which takes longer than its latency budget with `kerneltest_errc::latency_budget_exceeded`.
+  Only the call of the kernel is timed, and only kernels producing their expected outcome are failed. A kernel over
+  its budget is executed again, hooks and all, up to `remeasurements` times to filter out noise, the fastest of the
+  measurements being what is compared with the budget. `pretty_print_failure()` prints how long the kernel took
+  and what its budget was.
+  */
+  inline latency_budget_impl::inst latency_budget(size_t remeasurements = 2) { return latency_budget_impl::inst{remeasurements, std::make_shared<latency_budget_impl::overruns>()}; }
+}  // namespace hooks
+
+KERNELTEST_V1_NAMESPACE_END
+
+#endif
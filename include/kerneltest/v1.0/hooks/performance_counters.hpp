@@ -0,0 +1,342 @@
+/* Hardware performance counters test kernel hook
+(C) 2026 agent <agent@local>
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#include "../config.hpp"
+
+#ifndef KERNELTEST_HOOKS_PERFORMANCE_COUNTERS_HPP
+#define KERNELTEST_HOOKS_PERFORMANCE_COUNTERS_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+KERNELTEST_V1_NAMESPACE_BEGIN
+
+namespace hooks
+{
+  //! The counts of events during one call of a kernel
+  struct performance_counts
+  {
+    //! Where the counts came from, and so which of them are valid
+    enum class source_type : unsigned char
+    {
+      none,      //!< No counters were available
+      rusage,    //!< Only `page_faults` and `context_switches` are valid, read from `getrusage()`
+      software,  //!< Only `page_faults` and `context_switches` are valid, counted by the kernel
+      hardware   //!< All counts are valid
+    } source{source_type::none};
+    uint64_t cycles{0};            //!< CPU cycles
+    uint64_t instructions{0};      //!< Instructions retired
+    uint64_t cache_misses{0};      //!< Last level cache misses
+    uint64_t branch_misses{0};     //!< Mispredicted branches
+    uint64_t page_faults{0};       //!< Page faults, minor and major
+    uint64_t context_switches{0};  //!< Context switches, voluntary and involuntary
+  };
+
+  //! Returns the name of the source of some performance counts
+  inline const char *to_string(performance_counts::source_type v) noexcept
+  {
+    switch(v)
+    {
+    case performance_counts::source_type::rusage:
+      return "rusage";
+    case performance_counts::source_type::software:
+      return "software";
+    case performance_counts::source_type::hardware:
+      return "hardware";
+    default:
+      return "none";
+    }
+  }
+  //! Returns the printed form of some performance counts
+  inline std::string print(const performance_counts &v)
+  {
+    std::ostringstream s;
+    if(v.source == performance_counts::source_type::hardware)
+      s << v.cycles << " cycles, " << v.instructions << " instructions, " << v.cache_misses << " cache misses, " << v.branch_misses << " branch misses, ";
+    s << v.page_faults << " page faults, " << v.context_switches << " context switches";
+    if(v.source != performance_counts::source_type::hardware)
+      s << " (" << to_string(v.source) << " counters)";
+    return s.str();
+  }
+
+  namespace performance_counters_impl
+  {
+#ifdef __linux__
+    /* A group of perf_event_open() counters of the calling thread, which are opened when first used
+    and closed when the thread exits. Page faults and context switches are counted in the kernel, so their
+    software events must include it, which /proc/sys/kernel/perf_event_paranoid may forbid, in which case
+    they are read from getrusage() alongside the hardware events. Hardware events are usually unavailable
+    in virtual machines and containers, in which case only the software events are opened, and if those
+    are also refused, getrusage() is read instead.
+    */
+    class thread_counters
+    {
+      enum
+      {
+        max_events = 6
+      };
+      int _fds[max_events];
+      int _count{0};
+      pid_t _pid{0};
+      performance_counts::source_type _source{performance_counts::source_type::none};
+      bool _rusage{false};  // True if page faults and context switches are read from getrusage()
+      struct rusage _begin;
+
+      bool _open(const uint32_t *types, const uint64_t *configs, int count)
+      {
+        for(int n = 0; n < count; n++)
+        {
+          struct perf_event_attr attr;
+          memset(&attr, 0, sizeof(attr));
+          attr.size = sizeof(attr);
+          attr.type = types[n];
+          attr.config = configs[n];
+          attr.disabled = (n == 0);
+          // Kernel and hypervisor events are the most likely to be refused, but the software
+          // events happen in the kernel, so would never be counted if it were excluded
+          attr.exclude_kernel = (types[n] != PERF_TYPE_SOFTWARE);
+          attr.exclude_hv = 1;
+          attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+          int fd = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, (n == 0) ? -1 : _fds[0], PERF_FLAG_FD_CLOEXEC));
+          if(fd < 0)
+          {
+            const int errcode = errno;
+            _close();
+            errno = errcode;
+            return false;
+          }
+          _fds[_count++] = fd;
+        }
+        return true;
+      }
+      void _close() noexcept
+      {
+        while(_count > 0)
+          ::close(_fds[--_count]);
+      }
+      void _warn_once(const char *what, int errcode)
+      {
+        static std::atomic<bool> warned(false);
+        if(!warned.exchange(true))
+        {
+          detail::log_capture_suspended uncaptured;
+          KERNELTEST_CERR("WARNING: " << what << " performance counters are unavailable due to " << strerror(errcode) << ", falling back to " << to_string(_source) << " counters" << std::endl);
+        }
+      }
+      void _reopen()
+      {
+        _close();
+        _pid = getpid();
+        _rusage = false;
+        static const uint32_t hardware_types[] = {PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_SOFTWARE, PERF_TYPE_SOFTWARE};
+        static const uint64_t hardware_configs[] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES, PERF_COUNT_SW_PAGE_FAULTS, PERF_COUNT_SW_CONTEXT_SWITCHES};
+        if(_open(hardware_types, hardware_configs, 6))
+        {
+          _source = performance_counts::source_type::hardware;
+          return;
+        }
+        const int hardware_errcode = errno;
+        // Counting in the kernel may be what was refused
+        if(_open(hardware_types, hardware_configs, 4))
+        {
+          _source = performance_counts::source_type::hardware;
+          _rusage = true;
+          return;
+        }
+        static const uint32_t software_types[] = {PERF_TYPE_SOFTWARE, PERF_TYPE_SOFTWARE};
+        static const uint64_t software_configs[] = {PERF_COUNT_SW_PAGE_FAULTS, PERF_COUNT_SW_CONTEXT_SWITCHES};
+        if(_open(software_types, software_configs, 2))
+        {
+          _source = performance_counts::source_type::software;
+          _warn_once("Hardware", hardware_errcode);
+          return;
+        }
+        _source = performance_counts::source_type::rusage;
+        _rusage = true;
+        _warn_once("Hardware and software", errno);
+      }
+      // Sets the page faults and context switches of ret to those since _begin
+      bool _read_rusage(performance_counts &ret) const
+      {
+        struct rusage end;
+        if(getrusage(RUSAGE_THREAD, &end) < 0)
+          return false;
+        ret.page_faults = static_cast<uint64_t>((end.ru_minflt - _begin.ru_minflt) + (end.ru_majflt - _begin.ru_majflt));
+        ret.context_switches = static_cast<uint64_t>((end.ru_nvcsw - _begin.ru_nvcsw) + (end.ru_nivcsw - _begin.ru_nivcsw));
+        return true;
+      }
+
+    public:
+      thread_counters() = default;
+      thread_counters(const thread_counters &) = delete;
+      thread_counters &operator=(const thread_counters &) = delete;
+      ~thread_counters() { _close(); }
+
+      //! The counters of the calling thread
+      static thread_counters &get()
+      {
+        static thread_local thread_counters v;
+        return v;
+      }
+
+      //! Zeroes and starts the counters
+      void start()
+      {
+        // A forked child inherits counters of the thread in the parent, not of itself
+        if(_pid != getpid())
+          _reopen();
+        if(_rusage)
+          getrusage(RUSAGE_THREAD, &_begin);
+        if(_count > 0)
+        {
+          ioctl(_fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+          ioctl(_fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        }
+      }
+      //! Stops the counters, returning what they counted since start()
+      performance_counts stop()
+      {
+        performance_counts ret;
+        if(_count > 0)
+        {
+          ioctl(_fds[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+          uint64_t buffer[3 + max_events];
+          if(::read(_fds[0], buffer, sizeof(buffer)) < static_cast<ssize_t>((3 + _count) * sizeof(uint64_t)) || buffer[2] == 0)
+            return ret;
+          // If the group had to share the PMU with other groups, scale up to the whole time it was enabled
+          const double scale = static_cast<double>(buffer[1]) / static_cast<double>(buffer[2]);
+          auto value = [&](int n) { return static_cast<uint64_t>(static_cast<double>(buffer[3 + n]) * scale); };
+          ret.source = _source;
+          if(_source == performance_counts::source_type::hardware)
+          {
+            ret.cycles = value(0);
+            ret.instructions = value(1);
+            ret.cache_misses = value(2);
+            ret.branch_misses = value(3);
+            if(_rusage)
+            {
+              if(!_read_rusage(ret))
+                return performance_counts();
+            }
+            else
+            {
+              ret.page_faults = value(4);
+              ret.context_switches = value(5);
+            }
+          }
+          else
+          {
+            ret.page_faults = value(0);
+            ret.context_switches = value(1);
+          }
+          return ret;
+        }
+        if(!_read_rusage(ret))
+          return ret;
+        ret.source = performance_counts::source_type::rusage;
+        return ret;
+      }
+    };
+#else
+    // No counters are available on this platform
+    class thread_counters
+    {
+    public:
+      static thread_counters &get()
+      {
+        static thread_local thread_counters v;
+        return v;
+      }
+      void start() {}
+      performance_counts stop() { return performance_counts(); }
+    };
+#endif
+
+    struct counts_table
+    {
+      std::mutex lock;
+      std::unordered_map<size_t, performance_counts> v;
+    };
+    // Instantiated during permuter construction
+    struct inst
+    {
+      std::shared_ptr<counts_table> _counts;
+
+      // Called at the beginning of an individual test. The permuter starts and stops the counters around the kernel.
+      template <class Parent, class RetType> int operator()(Parent * /*unused*/, RetType & /*unused*/, size_t /*unused*/) const { return 0; }
+      std::string print() const { return "performance counters"; }
+
+      //! Starts counting on the calling thread
+      void start() const { thread_counters::get().start(); }
+      //! Stops counting on the calling thread, returning the counts
+      performance_counts stop() const { return thread_counters::get().stop(); }
+      //! Records the counts for the permutation at idx, which allocates, so not while a heap accounting hook is alive
+      void record(size_t idx, const performance_counts &counts) const
+      {
+        std::lock_guard<std::mutex> g(_counts->lock);
+        _counts->v[idx] = counts;
+      }
+      //! Returns true and fills in out if the permutation at idx has been executed by this process
+      bool counts(size_t idx, performance_counts &out) const
+      {
+        std::lock_guard<std::mutex> g(_counts->lock);
+        auto it = _counts->v.find(idx);
+        if(it == _counts->v.end())
+          return false;
+        out = it->second;
+        return true;
+      }
+    };
+  }  // namespace performance_counters_impl
+  //! The parameters for the performance counters hook, of which there are none
+  using performance_counters_parameters = parameters<>;
+  /*! Kernel test hook counting the CPU cycles, instructions, cache misses, branch misses, page faults and
+  context switches of the call of the kernel on the thread calling it, using `perf_event_open()` on Linux.
+  Where hardware events are refused the software events are counted instead, and failing those `getrusage()`
+  is read, so only page faults and context switches are reported. On other platforms nothing is counted.
+  The pretty printers print the counts of each permutation, and `write_performance_counts()` writes them
+  all as CSV. Permutations executed by `parameter_permuter::isolated()` are counted in the child process, and
+  so are not seen by the parent.
+  */
+  inline performance_counters_impl::inst performance_counters() { return performance_counters_impl::inst{std::make_shared<performance_counters_impl::counts_table>()}; }
+}  // namespace hooks
+
+KERNELTEST_V1_NAMESPACE_END
+
+#endif
@@ -57,10 +57,31 @@ import KERNELTEST_MODULE_NAME;
 
 #include "test_kernel.hpp"
 
+#include "benchmark.hpp"
+#include "cartesian_product.hpp"
+#include "check_summary.hpp"
+#include "command_line.hpp"
+#include "cost_profile.hpp"
+#include "covering_array.hpp"
+#include "executor.hpp"
+#include "fork_server.hpp"
+#include "generated_sequence.hpp"
+#include "log_capture.hpp"
+#include "parameter_hash.hpp"
 #include "permute_parameters.hpp"
+#include "recorded_outcome.hpp"
+#include "result_cache.hpp"
+#include "shard.hpp"
+#include "shared_file.hpp"
+#include "signal_recovery.hpp"
+#include "topology.hpp"
+#include "watchdog.hpp"
 #include "child_process.hpp"
 
 #include "hooks/custom.hpp"
 #include "hooks/filesystem_workspace.hpp"
+#include "hooks/heap_accounting.hpp"
+#include "hooks/latency_budget.hpp"
+#include "hooks/performance_counters.hpp"
 
 #endif
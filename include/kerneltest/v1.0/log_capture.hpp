@@ -0,0 +1,225 @@
+/* Per permutation capture of what is written to KERNELTEST_COUT and KERNELTEST_CERR
+(C) 2026 agent <agent@local>
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#include "config.hpp"
+
+#ifndef KERNELTEST_LOG_CAPTURE_HPP
+#define KERNELTEST_LOG_CAPTURE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+KERNELTEST_V1_NAMESPACE_BEGIN
+
+/*! \brief What a permuter does with what its permutations write to `KERNELTEST_COUT` and `KERNELTEST_CERR`
+
+Only output written through those macros on the thread executing the permutation can be captured, and
+only if they have not been redefined. Output written directly to `std::cout` or by other threads is not.
+*/
+enum class log_capture_mode
+{
+  automatic,  //!< `failures` for multithreaded permuters, or `always` if `--kerneltest-verbose` is on the command line. `off` for single threaded permuters.
+  off,        //!< Output is written as it happens
+  failures,   //!< Output is captured per permutation, and kept only for permutations which do not produce their expected outcome
+  always      //!< Output is captured per permutation, and kept for every permutation
+};
+
+namespace detail
+{
+  /* A streambuf keeping the last capacity bytes written to it, so a permutation which writes a great
+  deal costs bounded memory, and what it wrote just before it failed is what gets kept.
+  */
+  class log_ring : public std::streambuf
+  {
+    std::vector<char> _buffer;
+    size_t _written{0};
+
+    void _put(const char *s, size_t n)
+    {
+      const size_t capacity = _buffer.size();
+      if(n > capacity)
+      {
+        s += n - capacity;
+        _written += n - capacity;
+        n = capacity;
+      }
+      const size_t offset = _written % capacity;
+      const size_t first = std::min(n, capacity - offset);
+      memcpy(_buffer.data() + offset, s, first);
+      memcpy(_buffer.data(), s + first, n - first);
+      _written += n;
+    }
+
+  protected:
+    int_type overflow(int_type c) override
+    {
+      if(!traits_type::eq_int_type(c, traits_type::eof()))
+      {
+        const char v = traits_type::to_char_type(c);
+        _put(&v, 1);
+      }
+      return traits_type::not_eof(c);
+    }
+    std::streamsize xsputn(const char *s, std::streamsize n) override
+    {
+      _put(s, static_cast<size_t>(n));
+      return n;
+    }
+
+  public:
+    explicit log_ring(size_t capacity)
+        : _buffer(std::max(capacity, size_t(1)))
+    {
+    }
+    //! The most bytes kept
+    size_t capacity() const noexcept { return _buffer.size(); }
+    //! Forgets everything written
+    void clear() noexcept { _written = 0; }
+    //! Returns what was kept of what was written since the last clear, saying how much was dropped, and clears
+    std::string take()
+    {
+      std::string ret;
+      const size_t capacity = _buffer.size();
+      if(_written > capacity)
+      {
+        const size_t offset = _written % capacity;
+        ret = "[" + std::to_string(_written - capacity) + " bytes of earlier output dropped]\n";
+        ret.append(_buffer.data() + offset, capacity - offset);
+        ret.append(_buffer.data(), offset);
+      }
+      else
+        ret.assign(_buffer.data(), _written);
+      _written = 0;
+      return ret;
+    }
+  };
+
+  /* Captures what the calling thread writes to KERNELTEST_COUT and KERNELTEST_CERR while it executes
+  one permutation into a ring buffer reused by every permutation the thread executes. If the thread
+  is already capturing, for example because a kernel called another permuter, the output goes to the
+  outer capture and this one is inactive.
+  */
+  class permutation_log_scope
+  {
+    struct thread_capture
+    {
+      log_ring ring;
+      std::ostream stream;
+      explicit thread_capture(size_t capacity)
+          : ring(capacity)
+          , stream(&ring)
+      {
+      }
+    };
+    thread_capture *_capture{nullptr};
+
+  public:
+    explicit permutation_log_scope(size_t capacity)
+    {
+      static thread_local std::unique_ptr<thread_capture> v;
+      if(log_capture() != nullptr)
+        return;
+      if(!v || v->ring.capacity() != capacity)
+        v.reset(new thread_capture(capacity));
+      _capture = v.get();
+      _capture->ring.clear();
+      _capture->stream.clear();
+      log_capture() = &_capture->stream;
+    }
+    permutation_log_scope(const permutation_log_scope &) = delete;
+    permutation_log_scope &operator=(const permutation_log_scope &) = delete;
+    ~permutation_log_scope()
+    {
+      if(_capture != nullptr)
+        log_capture() = nullptr;
+    }
+    //! True if this scope is capturing
+    bool active() const noexcept { return _capture != nullptr; }
+    //! Stops capturing, returning what was captured
+    std::string finish()
+    {
+      log_capture() = nullptr;
+      std::string ret = _capture->ring.take();
+      _capture = nullptr;
+      return ret;
+    }
+  };
+
+  // The captured output of the permutations of a permuter which was kept
+  class captured_logs
+  {
+    mutable std::mutex _lock;
+    std::unordered_map<size_t, std::string> _logs;
+    std::atomic<size_t> _count{0};
+
+  public:
+    //! Keeps the output of the permutation at idx
+    void keep(size_t idx, std::string log)
+    {
+      std::lock_guard<std::mutex> g(_lock);
+      _logs[idx] = std::move(log);
+      _count = _logs.size();
+    }
+    //! Forgets any output of the permutation at idx from an earlier execution, which is usually none
+    void forget(size_t idx)
+    {
+      if(_count == 0)
+        return;
+      std::lock_guard<std::mutex> g(_lock);
+      _logs.erase(idx);
+      _count = _logs.size();
+    }
+    //! Forgets the output of every permutation, when the parameter sequence is executed again
+    void clear()
+    {
+      std::lock_guard<std::mutex> g(_lock);
+      _logs.clear();
+      _count = 0;
+    }
+    //! Returns true and fills in out if the output of the permutation at idx was kept
+    bool find(size_t idx, std::string &out) const
+    {
+      if(_count == 0)
+        return false;
+      std::lock_guard<std::mutex> g(_lock);
+      auto it = _logs.find(idx);
+      if(it == _logs.end())
+        return false;
+      out = it->second;
+      return true;
+    }
+  };
+}  // namespace detail
+
+KERNELTEST_V1_NAMESPACE_END
+
+#endif
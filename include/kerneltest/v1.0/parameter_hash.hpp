@@ -0,0 +1,127 @@
+/* Hashing of parameter sets
+(C) 2026 agent <agent@local>
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#include "config.hpp"
+
+#ifndef KERNELTEST_PARAMETER_HASH_HPP
+#define KERNELTEST_PARAMETER_HASH_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+KERNELTEST_V1_NAMESPACE_BEGIN
+
+namespace detail
+{
+  // 64 bit FNV-1a, chosen because its output is identical on every platform and every run
+  struct fnv1a_hasher
+  {
+    uint64_t state{14695981039346656037ULL};
+    void operator()(const void *data, size_t bytes) noexcept
+    {
+      auto *p = static_cast<const unsigned char *>(data);
+      for(size_t n = 0; n < bytes; n++)
+      {
+        state ^= p[n];
+        state *= 1099511628211ULL;
+      }
+    }
+  };
+
+  template <size_t N> struct hash_priority : hash_priority<N - 1>
+  {
+  };
+  template <> struct hash_priority<0>
+  {
+  };
+
+  // Parameters are hashed by value where we can, so the hash of a parameter set
+  // is the same in every run of the test program. Pointers to strings are hashed
+  // as strings, tuples recurse, and anything we don't know how to hash contributes
+  // nothing. Nor do any other pointers, smart or not, as what they point to is at
+  // a different address in each run.
+  template <class... Types> inline void hash_parameter(fnv1a_hasher &h, const std::tuple<Types...> &v, hash_priority<4>);
+  template <class T> inline auto hash_parameter(fnv1a_hasher &h, T *v, hash_priority<4>) -> typename std::enable_if<std::is_same<typename std::remove_cv<T>::type, char>::value>::type
+  {
+    static constexpr unsigned char null_marker = 0xff;
+    if(v != nullptr)
+      h(v, strlen(v) + 1);
+    else
+      h(&null_marker, 1);
+  }
+  template <class T> inline auto hash_parameter(fnv1a_hasher & /*unused*/, T * /*unused*/, hash_priority<4>) -> typename std::enable_if<!std::is_same<typename std::remove_cv<T>::type, char>::value>::type {}
+  template <class T> inline auto hash_parameter(fnv1a_hasher & /*unused*/, const T &v, hash_priority<4>) -> typename std::enable_if<std::is_pointer<decltype(v.get())>::value && std::is_same<typename T::element_type, typename std::remove_pointer<decltype(v.get())>::type>::value>::type {}
+  template <class C, class Traits, class A> inline void hash_parameter(fnv1a_hasher &h, const std::basic_string<C, Traits, A> &v, hash_priority<4>) { h(v.data(), (v.size() + 1) * sizeof(C)); }
+  inline void hash_parameter(fnv1a_hasher &h, const filesystem::path &v, hash_priority<4>) { h(v.native().data(), (v.native().size() + 1) * sizeof(filesystem::path::value_type)); }
+  template <class T> inline auto hash_parameter(fnv1a_hasher &h, const T &v, hash_priority<4>) -> typename std::enable_if<std::is_arithmetic<T>::value || std::is_enum<T>::value>::type { h(&v, sizeof(v)); }
+  template <class T> inline auto hash_parameter(fnv1a_hasher &h, const T &v, hash_priority<3>) -> decltype((void) (std::declval<std::ostream &>() << v))
+  {
+    std::ostringstream s;
+    s << v;
+    auto str = s.str();
+    h(str.data(), str.size() + 1);
+  }
+  template <class T> inline auto hash_parameter(fnv1a_hasher &h, const T &v, hash_priority<2>) -> decltype((void) std::hash<T>()(v))
+  {
+    size_t x = std::hash<T>()(v);
+    h(&x, sizeof(x));
+  }
+  template <class T> inline auto hash_parameter(fnv1a_hasher &h, const T &v, hash_priority<1>) -> typename std::enable_if<std::is_trivially_copyable<T>::value>::type { h(&v, sizeof(v)); }
+  template <class T> inline void hash_parameter(fnv1a_hasher &, const T &, hash_priority<0>) {}
+  template <class... Types, size_t... Idxs> inline void hash_parameters(fnv1a_hasher &h, const std::tuple<Types...> &v, std::index_sequence<Idxs...>)
+  {
+    using expand = int[];
+    (void) expand{0, (hash_parameter(h, std::get<Idxs>(v), hash_priority<4>()), 0)...};
+  }
+  template <class... Types> inline void hash_parameter(fnv1a_hasher &h, const std::tuple<Types...> &v, hash_priority<4>) { hash_parameters(h, v, std::make_index_sequence<sizeof...(Types)>()); }
+
+  template <class T, size_t... Idxs> inline uint64_t hash_parameter_set(const T &v, std::index_sequence<Idxs...>)
+  {
+    fnv1a_hasher h;
+    using expand = int[];
+    // Element zero is the expected outcome, which is not part of the identity of a permutation
+    (void) expand{0, (hash_parameter(h, std::get<1 + Idxs>(v), hash_priority<4>()), 0)...};
+    return h.state;
+  }
+}  // namespace detail
+
+/*! \brief Returns a hash of the kernel and hook parameters of an individual parameter set,
+which is stable across runs of the same test program. The expected outcome is not hashed.
+
+C strings are hashed by their contents, but other pointers and smart pointers are left out
+of the hash, as their addresses differ between runs. Parameter sets differing only in what
+such parameters point to therefore hash the same.
+*/
+template <class... Types> inline uint64_t hash_parameter_set(const parameters<Types...> &v)
+{
+  return detail::hash_parameter_set(v, std::make_index_sequence<sizeof...(Types) - 1>());
+}
+
+KERNELTEST_V1_NAMESPACE_END
+
+#endif
@@ -27,12 +27,45 @@ Distributed under the Boost Software License, Version 1.0.
 #ifndef KERNELTEST_PERMUTE_PARAMETERS_HPP
 #define KERNELTEST_PERMUTE_PARAMETERS_HPP
 
+#include "benchmark.hpp"
+#include "check_summary.hpp"
+#include "cost_profile.hpp"
+#include "covering_array.hpp"
+#include "executor.hpp"
+#include "fork_server.hpp"
+#include "generated_sequence.hpp"
+#include "log_capture.hpp"
+#include "parameter_hash.hpp"
+#include "recorded_outcome.hpp"
+#include "result_cache.hpp"
+#include "shard.hpp"
+#include "signal_recovery.hpp"
+#include "topology.hpp"
+#include "watchdog.hpp"
+
+#include "hooks/heap_accounting.hpp"
+#include "hooks/latency_budget.hpp"
+#include "hooks/performance_counters.hpp"
+
 #include "quickcpplib/console_colours.hpp"
 #include "quickcpplib/type_traits.hpp"
 
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
 #include <vector>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 #ifdef _MSC_VER
 #pragma warning(push)
 #pragma warning(disable : 6326)  // comparison of constants
@@ -52,14 +85,95 @@ namespace detail
     static constexpr bool value = true;
     static constexpr size_t size = N;
   };
+  // A window onto the results of the permutations [base, base + size) of a much longer
+  // sequence, so the results of the whole sequence never need exist at once
+  template <class T> class streamed_permutation_results
+  {
+    size_t _base{0};
+    std::vector<optional<T>> _v;
+
+  public:
+    using value_type = optional<T>;
+    using const_iterator = typename std::vector<optional<T>>::const_iterator;
+
+    // Destroys the results of the current window, and makes [base, base + size) the new one
+    void reset(size_t base, size_t size)
+    {
+      _v.clear();
+      _v.resize(size);
+      _base = base;
+    }
+    size_t base() const noexcept { return _base; }
+    size_t size() const noexcept { return _v.size(); }
+    optional<T> &operator[](size_t idx) { return _v[idx - _base]; }
+    const optional<T> &operator[](size_t idx) const { return _v[idx - _base]; }
+    const_iterator begin() const noexcept { return _v.begin(); }
+    const_iterator end() const noexcept { return _v.end(); }
+    const_iterator cbegin() const noexcept { return _v.cbegin(); }
+    const_iterator cend() const noexcept { return _v.cend(); }
+  };
+  // The result of a single permutation executed by an abandonable_runner, owned by the job so it can be abandoned
+  template <class T> struct abandonable_permutation
+  {
+    optional<T> result;
+    volatile int stage{0};
+    optional<T> &operator[](size_t) noexcept { return result; }
+  };
+  // Indexes the parameter sets of a sequence, which is walked once for a table of pointers to its items
+  // so that sequences without random access can be permuted
+  template <class ParamSequence> class parameter_table
+  {
+    std::vector<const typename ParamSequence::value_type *> _items;
+
+  public:
+    explicit parameter_table(const ParamSequence &seq)
+    {
+      _items.reserve(seq.size());
+      for(const auto &i : seq)
+        _items.push_back(&i);
+    }
+    const typename ParamSequence::value_type &operator[](size_t idx) const { return *_items[idx]; }
+  };
+  // Generated sequences instead generate the parameter set at idx when it is indexed
+  template <class T, class Generator> class parameter_table<generated_sequence<T, Generator>>
+  {
+    const generated_sequence<T, Generator> *_seq;
+
+  public:
+    explicit parameter_table(const generated_sequence<T, Generator> &seq)
+        : _seq(&seq)
+    {
+    }
+    T operator[](size_t idx) const { return (*_seq)[idx]; }
+  };
+  // Returns the parameter set at idx of a sequence without tabling it, walking to it if need be
+  template <class ParamSequence> const typename ParamSequence::value_type &parameter_at(const ParamSequence &seq, size_t idx)
+  {
+    auto it(seq.begin());
+    std::advance(it, idx);
+    return *it;
+  }
+  template <class T, class Generator> T parameter_at(const generated_sequence<T, Generator> &seq, size_t idx) { return seq[idx]; }
+  // True if the parameter sequence is generated on demand
+  template <class ParamSequence> struct is_generated_sequence : std::false_type
+  {
+  };
+  template <class T, class Generator> struct is_generated_sequence<generated_sequence<T, Generator>> : std::true_type
+  {
+  };
+  // The length of a generated sequence beyond which hashing every permutation up front is warned about
+  static constexpr size_t large_generated_sequence = size_t(1) << 20;
+
   template <class ParamSequence, bool = has_constant_size<ParamSequence>::value> struct permutation_results_type
   {
     template <class T> using type = std::vector<optional<T>>;
+    template <class T> using streamed_type = streamed_permutation_results<T>;
     constexpr ParamSequence operator()(size_t no) const { return ParamSequence(no); }
   };
   template <class ParamSequence> struct permutation_results_type<ParamSequence, true>
   {
     template <class T> using type = std::array<optional<T>, has_constant_size<ParamSequence>::size>;
+    template <class T> using streamed_type = streamed_permutation_results<T>;
     constexpr ParamSequence operator()(size_t) const { return ParamSequence(); }
   };
   template <class T> constexpr T make_permutation_results_type(size_t no) { return permutation_results_type<T>()(no); }
@@ -81,6 +195,16 @@ namespace detail
     using type = decltype(std::declval<Callable>()(std::declval<Types>()...));
   };
 
+  // The index of the first hook of type Hook in Hooks, or sizeof...(Hooks) if there isn't one
+  template <class Hook, size_t N, class... Hooks> struct hook_index
+  {
+    static constexpr size_t value = N;
+  };
+  template <class Hook, size_t N, class T, class... Hooks> struct hook_index<Hook, N, T, Hooks...>
+  {
+    static constexpr size_t value = std::is_same<Hook, typename std::decay<T>::type>::value ? N : hook_index<Hook, N + 1, Hooks...>::value;
+  };
+
   // Need a tuple whose destruction order is well known. This fellow destructs in
   // reverse order of Ts...
   template <class... Ts> struct hooks_container;
@@ -102,6 +226,87 @@ namespace detail
     {
     }
   };
+  template <> struct hooks_container<>
+  {
+  };
+
+  // True if Hook has a member function session() making the state it keeps between permutations
+  template <class Hook, class = void> struct has_hook_session : std::false_type
+  {
+  };
+  template <class Hook> struct has_hook_session<Hook, decltype((void) std::declval<const Hook &>().session())> : std::true_type
+  {
+  };
+  // The session of a hook without one of its own, which instantiates the hook itself for every permutation
+  template <class Hook> struct stateless_hook_session
+  {
+    const Hook *hook;
+    template <class Permuter, class Outcome, class... Args> auto operator()(Permuter *parent, Outcome &out, size_t idx, Args &&... args) const { return (*hook)(parent, out, idx, std::forward<Args>(args)...); }
+  };
+  template <class Hook> inline auto make_hook_session(const Hook &hook, std::true_type /*has session*/) { return hook.session(); }
+  template <class Hook> inline auto make_hook_session(const Hook &hook, std::false_type /*has session*/) { return stateless_hook_session<Hook>{&hook}; }
+  template <class... Hooks, size_t... Idxs> inline auto make_hook_sessions(const std::tuple<Hooks...> &hooks, std::index_sequence<Idxs...>) { return std::make_tuple(make_hook_session(std::get<Idxs>(hooks), has_hook_session<typename std::decay<Hooks>::type>())...); }
+
+  /* The sessions of the hooks of a permuter, one set for each worker executing permutations at once.
+  A worker leases a set for each permutation, and a set no worker has leased is handed to the next which
+  asks, so the sets are only ever created as many times as there are workers.
+  */
+  template <class... Hooks> class hook_session_pool
+  {
+  public:
+    using sessions_type = decltype(make_hook_sessions(std::declval<const std::tuple<Hooks...> &>(), std::make_index_sequence<sizeof...(Hooks)>()));
+
+    class lease
+    {
+      hook_session_pool *_pool;
+      std::unique_ptr<sessions_type> _v;
+
+    public:
+      lease(hook_session_pool *pool, std::unique_ptr<sessions_type> v)
+          : _pool(pool)
+          , _v(std::move(v))
+      {
+      }
+      lease(lease &&) noexcept = default;
+      lease(const lease &) = delete;
+      ~lease()
+      {
+        if(_v)
+        {
+          std::lock_guard<std::mutex> g(_pool->_lock);
+          _pool->_free.push_back(std::move(_v));
+        }
+      }
+      sessions_type &get() noexcept { return *_v; }
+    };
+
+  private:
+    const std::tuple<Hooks...> &_hooks;
+    std::mutex _lock;
+    std::vector<std::unique_ptr<sessions_type>> _free;
+
+  public:
+    explicit hook_session_pool(const std::tuple<Hooks...> &hooks)
+        : _hooks(hooks)
+    {
+    }
+    hook_session_pool(const hook_session_pool &) = delete;
+    hook_session_pool &operator=(const hook_session_pool &) = delete;
+
+    lease acquire()
+    {
+      {
+        std::lock_guard<std::mutex> g(_lock);
+        if(!_free.empty())
+        {
+          lease ret(this, std::move(_free.back()));
+          _free.pop_back();
+          return ret;
+        }
+      }
+      return lease(this, std::unique_ptr<sessions_type>(new sessions_type(make_hook_sessions(_hooks, std::make_index_sequence<sizeof...(Hooks)>()))));
+    }
+  };
 #ifdef _MSC_VER
 #pragma warning(push)
 #pragma warning(disable : 4100)  // unreferenced formal parameter
@@ -110,8 +315,9 @@ namespace detail
 #ifdef _MSC_VER
 #pragma warning(pop)
 #endif
-  template <class... Hooks, class Permuter, class Outcome, class ParamSequence, size_t... Idxs> auto instantiate_hooks(const std::tuple<Hooks...> &hooks, Permuter *parent, Outcome &out, size_t idx, const ParamSequence &pars, std::index_sequence<Idxs...>)
+  template <class... Sessions, class Permuter, class Outcome, class ParamSequence, size_t... Idxs> auto instantiate_hooks(std::tuple<Sessions...> &hooks, Permuter *parent, Outcome &out, size_t idx, const ParamSequence &pars, std::index_sequence<Idxs...>)
   {
+    // hooks are the sessions of the hooks, which may be the hooks themselves
     // callspec is (parameter_permuter<...> *parent, outcome<T> &testret, size_t, pars)
     // pars<0> is expected outcome, pars<1> is kernel parameter set. pars<2> onwards are the hook parameters
     //
@@ -214,9 +420,193 @@ namespace detail
       return a.error() == b.error();
     return false;
   }
+
+  template <class R> inline std::string describe_outcome(const R &v, std::true_type /*printable*/) { return print(v); }
+  template <class R> inline std::string describe_outcome(const R &v, std::false_type /*printable*/)
+  {
+    if(v.has_value())
+      return "(unprintable value)";
+    if(v.has_error())
+    {
+#if !KERNELTEST_EXPERIMENTAL_STATUS_CODE
+      return OUTCOME_V2_NAMESPACE::policy::error_code(v.error()).message();
+#else
+      return "(error)";
+#endif
+    }
+    return "(exception)";
+  }
+  // Records a kernel outcome in a form which can leave this process
+  template <class R, class S> inline recorded_outcome make_recorded_outcome(const optional<R> &kernel_outcome, const S &shouldbe)
+  {
+    const R &v = kernel_outcome.value();
+    auto state = v.has_value() ? recorded_outcome::state_type::value : v.has_error() ? recorded_outcome::state_type::error : recorded_outcome::state_type::exception;
+    auto category = recorded_outcome::category_type::none;
+    int64_t code = 0;
+#if !KERNELTEST_EXPERIMENTAL_STATUS_CODE
+    if(v.has_error())
+    {
+      std::error_code ec = OUTCOME_V2_NAMESPACE::policy::error_code(v.error());
+      code = ec.value();
+      if(ec.category() == std::generic_category())
+        category = recorded_outcome::category_type::generic;
+      else if(ec.category() == std::system_category())
+        category = recorded_outcome::category_type::system;
+      else if(strcmp(ec.category().name(), kerneltest_category().name()) == 0)
+        category = recorded_outcome::category_type::kerneltest;
+      else
+        category = recorded_outcome::category_type::other;
+    }
+#endif
+    return recorded_outcome(check_result(kernel_outcome, shouldbe), state, category, code, describe_outcome(v, std::integral_constant<bool, is_ostreamable<typename R::value_type>::value>()));
+  }
 }  // namespace detail
 
+namespace detail
+{
+  // If set, where the pretty printers of the calling thread write instead of KERNELTEST_COUT
+  inline std::ostream *&pretty_print_capture() noexcept
+  {
+    static QUICKCPPLIB_THREAD_LOCAL std::ostream *v;
+    return v;
+  }
+  // Captures what the pretty printers of the calling thread print into s for the lifetime of the instance
+  class pretty_print_capture_scope
+  {
+    std::ostream *_prev;
+
+  public:
+    explicit pretty_print_capture_scope(std::ostream &s) noexcept : _prev(pretty_print_capture()) { pretty_print_capture() = &s; }
+    pretty_print_capture_scope(const pretty_print_capture_scope &) = delete;
+    pretty_print_capture_scope &operator=(const pretty_print_capture_scope &) = delete;
+    ~pretty_print_capture_scope() { pretty_print_capture() = _prev; }
+  };
+
+  // The permutation whose outcome the calling thread is checking, so the pretty printers can find
+  // its parameter set without walking the parameter sequence to it
+  struct checked_row
+  {
+    const void *permuter;
+    size_t idx;
+    const void *pars;
+  };
+  inline const checked_row *&checked_row_of_thread() noexcept
+  {
+    static QUICKCPPLIB_THREAD_LOCAL const checked_row *v;
+    return v;
+  }
+  // Makes pars the parameter set of the permutation at idx of permuter for the lifetime of the instance
+  class checked_row_scope
+  {
+    checked_row _row;
+    const checked_row *_prev;
+
+  public:
+    checked_row_scope(const void *permuter, size_t idx, const void *pars) noexcept : _row{permuter, idx, pars}, _prev(checked_row_of_thread()) { checked_row_of_thread() = &_row; }
+    checked_row_scope(const checked_row_scope &) = delete;
+    checked_row_scope &operator=(const checked_row_scope &) = delete;
+    ~checked_row_scope() { checked_row_of_thread() = _prev; }
+  };
+  // Returns the parameter set of the permutation at idx of permuter if the calling thread is checking it, else null
+  template <class Permuter> inline const typename Permuter::parameter_sequence_value_type *checked_parameters(const Permuter &permuter, size_t idx) noexcept
+  {
+    const checked_row *row = checked_row_of_thread();
+    if(row == nullptr || row->permuter != static_cast<const void *>(&permuter) || row->idx != idx)
+      return nullptr;
+    return static_cast<const typename Permuter::parameter_sequence_value_type *>(row->pars);
+  }
+
+  // Sets result to the expected outcome of a permutation which passed in an earlier run
+  template <class R, class T> inline auto assign_expected_result(optional<R> &result, const T &shouldbe) -> typename std::enable_if<std::is_constructible<R, const T &>::value>::type { result.emplace(shouldbe); }
+  template <class R, class T> inline auto assign_expected_result(optional<R> &, const T &) -> typename std::enable_if<!std::is_constructible<R, const T &>::value>::type {}
+}  // namespace detail
+
+//! \brief Options affecting how a `parameter_permuter` executes its permutations
+struct permuter_options
+{
+  //! How a multithreaded permuter dispatches its permutations. Ignored by single threaded permuters.
+  permuter_executor executor{permuter_executor::automatic};
+  //! The number of worker threads of a multithreaded permuter. Zero means hardware concurrency.
+  size_t workers{0};
+  //! The number of permutations claimed per dispatch by `permuter_executor::thread_pool`. Zero means guided chunking.
+  size_t chunk{0};
+  /*! The `cost_profile` file in which to record the wall time of each permutation. Multithreaded permuters
+  dispatch permutations with recorded costs longest first. Empty means use the `KERNELTEST_COST_PROFILE`
+  environment variable, and if that is not set, don't profile. Profiling hashes every parameter set of the
+  sequence before any is executed, so costs time and memory in proportion to the length of the sequence.
+  */
+  filesystem::path cost_profile_path;
+  /*! Which shard of the parameter sequence this process runs. If not sharded, the shard given by
+  `--kerneltest-shard=i/n` on the command line or the `KERNELTEST_SHARD` environment variable is used.
+  */
+  shard_spec shard;
+  //! The directory for shard results files. Empty means the current working directory.
+  filesystem::path shard_directory;
+  /*! The `result_cache` file recording which permutations passed in earlier runs of this build. The call operator
+  and `parameter_permuter::isolated()` report these as passed without executing them. Empty means use the
+  `KERNELTEST_RESULT_CACHE` environment variable, and if that is not set, don't cache. `--kerneltest-no-cache`
+  on the command line forces every permutation to execute. Like profiling, caching hashes every parameter set
+  of the sequence before any is executed.
+  */
+  filesystem::path result_cache_path;
+  //! Parts of the file names of the shared libraries which, if rebuilt, invalidate the result cache.
+  std::vector<std::string> cache_dependencies;
+  /*! How long a permutation may execute before it fails with `kerneltest_errc::setup_timed_out`, `kernel_timed_out`
+  or `teardown_timed_out` depending on where it was. Zero means the number of milliseconds given by `--kerneltest-timeout=ms`
+  on the command line or the `KERNELTEST_TIMEOUT` environment variable, and if neither is present, forever.
+  */
+  std::chrono::milliseconds timeout{0};
+  //! If set, returns the timeout of the permutation at `idx`, zero meaning the timeout it would otherwise have.
+  std::function<std::chrono::milliseconds(size_t idx)> row_timeout;
+  /*! True to stop waiting for a permutation executed in process once it times out, abandoning the thread executing
+  it to finish by itself. Permutations with a timeout then execute on a helper thread of each worker. An abandoned
+  thread still refers to the callable and the permuter, so these must outlive it, which in practice means the process
+  should exit soon after the results have been checked. If false, a watchdog thread reports permutations as they time
+  out, but they are still waited for.
+  */
+  bool abandon_timed_out{false};
+  //! How long a permutation executed by `parameter_permuter::isolated()` may run before its worker process is killed, unless `row_timeout` says otherwise. Zero means `timeout`.
+  std::chrono::milliseconds isolation_timeout{0};
+  /*! True to recover from `SIGSEGV`, `SIGBUS`, `SIGFPE` and `SIGILL` raised by a permutation, which then
+  fails with `kerneltest_errc::setup_signal_thrown`, `kernel_signal_thrown` or `teardown_signal_thrown`
+  instead of terminating the process. Recovery jumps out of the permutation with `siglongjmp()`, so the
+  hooks of a recovered permutation are not torn down, and the destructors of everything else it had
+  constructed never run, leaking memory, workspaces and any locks held. This is undefined behaviour as
+  far as C++ is concerned, so it is off unless asked for. `parameter_permuter::isolated()` survives such
+  signals without it, at the cost of a worker process. Ignored on Windows.
+  */
+  bool recover_signals{false};
+  //! The number of permutations executed, and whose results are held, at a time by `parameter_permuter::stream()`. Zero means 65536.
+  size_t stream_window{0};
+  /*! True to stop starting permutations as soon as one does not produce its expected outcome. The results
+  of the permutations never started are left empty, and are reported as not run by `check()`. Also enabled
+  by `--kerneltest-fail-fast` on the command line or the `KERNELTEST_FAIL_FAST` environment variable.
+  */
+  bool fail_fast{false};
+  /*! Where the workers of a multithreaded permuter run. If not enabled, the affinity given on the command line
+  by `--kerneltest-pin`, `--kerneltest-numa-node` and `--kerneltest-cpus` is used. Pinned workers are always
+  dispatched by the thread pool, as OpenMP manages the placement of its own threads.
+  */
+  worker_affinity affinity;
+  /*! What to do with what permutations executed in process write to `KERNELTEST_COUT` and `KERNELTEST_CERR`. If
+  captured, each worker writes the output of each permutation into an in memory ring buffer, which is kept or
+  thrown away once the permutation has finished. `pretty_print_failure()` and `pretty_print_success()` print
+  the kept output of each permutation, and so in index order. Permutations executed by `parameter_permuter::isolated()`
+  are never captured.
+  */
+  log_capture_mode capture_log{log_capture_mode::automatic};
+  //! The most bytes kept of the output of each permutation when capturing, the most recent being kept. Zero means 65536.
+  size_t capture_log_size{0};
+};
+
 /*! \brief A parameter permuter instance
+
+Each hook is called with `(parent, testret, idx, hook parameters...)` for every permutation, returning an
+object whose construction sets up the permutation and whose destruction tears it down. A hook whose setup
+is expensive can instead have a member function `session()` returning a session object callable the same
+way. One session is made by each worker executing permutations, and it lives until the execution of the
+parameter sequence finishes, so state kept in the session is shared by every permutation executed by that
+worker. Hooks without `session()` are called directly as before.
 \tparam is_mt True if this is a multithreaded parameter permuter
 \tparam ParamSequence A sequence of parameter calls
 */
@@ -224,9 +614,14 @@ template <bool is_mt, class ParamSequence, class... Hooks> class parameter_permu
 {
   ParamSequence _params;
   std::tuple<Hooks...> _hooks;
+  permuter_options _options;
+  std::shared_ptr<detail::captured_logs> _logs{std::make_shared<detail::captured_logs>()};
 
   // syntax helper for MSVC :)
   using _permutation_results_type = typename detail::permutation_results_type<ParamSequence>;
+  // Shared by the copies of the callables executing permutations, which may outlive the execution if abandoned
+  using _parameter_table_ptr = std::shared_ptr<const detail::parameter_table<ParamSequence>>;
+  using _hook_session_pool_ptr = std::shared_ptr<detail::hook_session_pool<Hooks...>>;
 
 public:
   //! True if this parameter permuter is multithreaded
@@ -267,6 +662,8 @@ public:
   static constexpr bool permutation_results_type_is_constant_sized = parameter_sequence_type_is_constant_sized;
   //! Any constant size of the permutation_results_type if it is constant sized
   static constexpr size_t permutation_results_type_constant_size = parameter_sequence_type_constant_size;
+  //! The type of the window of results passed to the consumer of stream()
+  template <class T> using streamed_permutation_results_type = typename _permutation_results_type::template streamed_type<T>;
 
   //! Constructs an instance. Best to use mt_permute_parameters() or st_permute_parameters() instead.
   constexpr parameter_permuter(ParamSequence &&params, std::tuple<Hooks...> &&hooks)
@@ -279,10 +676,44 @@ public:
   const ParamSequence &parameter_sequence() const { return _params; }
   //! Returns the hooks this permuter was constructed with
   const std::tuple<Hooks...> &hooks() const { return _hooks; }
+  //! Returns the options affecting how this permuter executes its permutations
+  permuter_options &options() { return _options; }
+  //! \overload
+  const permuter_options &options() const { return _options; }
+  /*! If the permutation at `idx` was failed by a `hooks::latency_budget` when it was last executed by this process,
+  returns true and fills in `overrun` with how long it took and what its budget was.
+  */
+  bool latency_budget_overran(size_t idx, hooks::latency_budget_overrun &overrun) const
+  {
+    // The hook records the overrun, so the parameter set needn't be looked up
+    const hooks::latency_budget_impl::inst *hook = _latency_budget(std::integral_constant<bool, (_latency_budget_hook < sizeof...(Hooks))>());
+    return hook != nullptr && hook->overran(idx, overrun);
+  }
+  /*! If there is a `hooks::heap_accounting` and the permutation at `idx` has been executed in this process,
+  returns true and fills in `usage` with its heap usage when it was last executed.
+  */
+  bool heap_usage(size_t idx, hooks::heap_usage &usage) const
+  {
+    const hooks::heap_accounting_impl::inst *hook = _heap_accounting(std::integral_constant<bool, (_heap_accounting_hook < sizeof...(Hooks))>());
+    return hook != nullptr && hook->usage(idx, usage);
+  }
+  /*! If there is a `hooks::performance_counters` and the permutation at `idx` has been executed in this process,
+  returns true and fills in `counts` with what was counted during its last call of the kernel.
+  */
+  bool performance_counts(size_t idx, hooks::performance_counts &counts) const
+  {
+    const hooks::performance_counters_impl::inst *hook = _performance_counters(std::integral_constant<bool, (_performance_counters_hook < sizeof...(Hooks))>());
+    return hook != nullptr && hook->counts(idx, counts);
+  }
+  /*! If what the permutation at `idx` wrote to `KERNELTEST_COUT` and `KERNELTEST_CERR` in the last execution of the
+  parameter sequence was captured and kept due to `permuter_options::capture_log`, returns true and fills in `log`
+  with it. Each execution forgets what the last one captured, and `isolated()` captures nothing.
+  */
+  bool captured_log(size_t idx, std::string &log) const { return _logs->find(idx, log); }
   //! Convenience indexer into parameter sequence
-  auto &operator[](size_t idx) { return _params[idx]; }
+  decltype(auto) operator[](size_t idx) { return _params[idx]; }
   //! Convenience indexer into parameter sequence
-  const auto &operator[](size_t idx) const { return _params[idx]; }
+  decltype(auto) operator[](size_t idx) const { return _params[idx]; }
 
   /*! Permute the callable f with this parameter permuter, returning a sequence of results.
   \return An array or vector of results (depends on ParamSequence::size() being constexpr).
@@ -292,29 +723,538 @@ public:
   */
   template <class U> auto operator()(U &&f) const
   {
-    using return_type = typename detail::result_of_parameter_permute<parameter_sequence_value_type, U>::type;
-    using return_type_as_if_void = typename return_type::template rebind<void>;
-    static_assert(!std::is_void<typename outcome_type::value_type>::value ? (std::is_constructible<outcome_type, return_type>::value) : (std::is_constructible<outcome_type, return_type_as_if_void>::value), "Return type of callable is not compatible with the parameter outcome type");
+    using return_type = _return_type<U>;
+    permutation_results_type<return_type> results(detail::make_permutation_results_type<permutation_results_type<return_type>>(_params.size()));
+    _parameter_table_ptr params(_parameter_table());
+    _hook_session_pool_ptr pool(_hook_session_pool());
+    _logs->clear();
+    auto call_f = _make_call_f(f, results, params, pool);
+    // Cached permutations can only be reported if their expected outcome can be returned as a result
+    _dispatch_plan plan(_plan(*params, std::is_constructible<return_type, const outcome_type &>::value));
+    for(size_t idx = 0; idx < plan.cached.size(); idx++)
+    {
+      if(plan.cached[idx])
+        detail::assign_expected_result(results[idx], outcome_value((*params)[idx]));
+    }
+    const bool fail_fast = _fail_fast();
+    cancellation_token cancel;
+    const _timeouts timeouts(_make_timeouts(std::chrono::milliseconds(0), true));
+    auto dispatch = [&](size_t n) {
+      if(cancel.cancelled())
+        return;
+      const size_t idx = plan.index(n);
+      volatile int stage = 0;
+      if(plan.profile == nullptr)
+        _call_with_timeout(f, results, call_f, params, pool, timeouts, idx, stage);
+      else
+      {
+        auto begin = std::chrono::steady_clock::now();
+        _call_with_timeout(f, results, call_f, params, pool, timeouts, idx, stage);
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count();
+        plan.nanoseconds[idx] = (elapsed > 0) ? static_cast<uint64_t>(elapsed) : 1;
+      }
+      if(fail_fast && !detail::check_result(results[idx], outcome_value((*params)[idx])))
+        cancel.cancel(idx);
+    };
+#ifndef _WIN32
+    detail::signal_recovery_handlers handlers(_options.recover_signals);
+#endif
+    _execute(plan.count(results.size()), dispatch, plan.prioritised);
+    _report_cancelled(cancel, plan.count(results.size()), [&](size_t n) { return !!results[plan.index(n)]; });
+    _finish(plan, [&](size_t idx) -> optional<recorded_outcome> {
+      if(!results[idx])
+        return {};
+      return detail::make_recorded_outcome(results[idx], outcome_value((*params)[idx]));
+    });
+    return results;
+  }
+
+  /*! Permute the callable f with this parameter permuter like the call operator, but executing every
+  permutation in a `fork_server` worker process forked from this one, so that a permutation which crashes
+  or hangs cannot take down the test run. A permutation whose worker was killed by a signal fails with
+  `kerneltest_errc::setup_signal_thrown`, `kernel_signal_thrown` or `teardown_signal_thrown` depending
+  on where it was, and a permutation which runs for longer than `permuter_options::isolation_timeout` has
+  its worker killed with `SIGKILL`. Signals recovered in process due to `permuter_options::recover_signals`
+  fail the same way without costing a worker.
+
+  The outcomes of the kernel cannot leave the worker processes, so each is recorded where it was
+  produced. Single threaded permuters use one worker process, multithreaded permuters
+  `permuter_options::workers` of them, each sent `permuter_options::chunk` permutations at a time.
+  \return An array or vector of recorded outcomes, which can be checked and pretty printed like
+  the results of the call operator.
+  \throws std::system_error If the worker processes could not be created.
+  \param f Some callable with callspec result(typename ParamSequence::value_type ...)
+  */
+  template <class U> permutation_results_type<recorded_outcome> isolated(U &&f) const
+  {
+    using return_type = _return_type<U>;
+    permutation_results_type<return_type> results(detail::make_permutation_results_type<permutation_results_type<return_type>>(_params.size()));
+    // Output captured in a worker process would be lost with it
+    _parameter_table_ptr params(_parameter_table());
+    _hook_session_pool_ptr pool(_hook_session_pool());
+    _logs->clear();
+    auto call_f = _make_call_f(f, results, params, pool, false);
+    _dispatch_plan plan(_plan(*params, true));
+    permutation_results_type<recorded_outcome> ret(detail::make_permutation_results_type<permutation_results_type<recorded_outcome>>(_params.size()));
+    for(size_t idx = 0; idx < plan.cached.size(); idx++)
+    {
+      if(plan.cached[idx])
+      {
+        const parameter_sequence_value_type &pars = (*params)[idx];
+        ret[idx] = detail::make_recorded_outcome(optional<outcome_type>(outcome_value(pars)), outcome_value(pars));
+      }
+    }
+    const bool fail_fast = _fail_fast();
+    cancellation_token cancel;
+    // Executed in a worker, which sends back the cost and the recorded outcome
+    auto execute = [&](size_t n, volatile int &stage) {
+      const size_t idx = plan.index(n);
+      auto begin = std::chrono::steady_clock::now();
+      call_f(idx, stage);
+      auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count();
+      const uint64_t nanoseconds = (elapsed > 0) ? static_cast<uint64_t>(elapsed) : 1;
+      std::ostringstream s;
+      s.write(reinterpret_cast<const char *>(&nanoseconds), sizeof(nanoseconds));
+      detail::make_recorded_outcome(results[idx], outcome_value((*params)[idx])).write(s);
+      results[idx].reset();
+      return s.str();
+    };
+    auto complete = [&](size_t n, const char *data, size_t length) {
+      const size_t idx = plan.index(n);
+      std::istringstream s(std::string(data, length));
+      uint64_t nanoseconds = 0;
+      recorded_outcome outcome;
+      s.read(reinterpret_cast<char *>(&nanoseconds), sizeof(nanoseconds));
+      if(!s || !outcome.read(s))
+        throw std::runtime_error("corrupt recorded outcome returned by fork server worker");
+      if(plan.profile != nullptr)
+        plan.nanoseconds[idx] = nanoseconds;
+      ret[idx] = std::move(outcome);
+      if(fail_fast && !ret[idx]->passed())
+        cancel.cancel(idx);
+    };
+    auto died = [&](size_t n, int stage, int signo, bool timed_out) {
+      const size_t idx = plan.index(n);
+      kerneltest_errc code = kerneltest_errc::setup_signal_thrown;
+      if(timed_out)
+        code = detail::timed_out_code(stage);
+      else if(1 == stage)
+        code = kerneltest_errc::kernel_signal_thrown;
+      else if(2 == stage)
+        code = kerneltest_errc::teardown_signal_thrown;
+      if(timed_out)
+      {
+        KERNELTEST_CERR("WARNING: Permutation " << idx << " exceeded its timeout and was killed" << std::endl);
+      }
+      else if(signo != 0)
+      {
+        KERNELTEST_CERR("WARNING: Permutation " << idx << " was killed by signal " << signo << std::endl);
+      }
+      else
+      {
+        KERNELTEST_CERR("WARNING: Permutation " << idx << " exited its worker process" << std::endl);
+      }
+      optional<return_type> outcome(return_type(in_place_type<typename return_type::error_type>, make_error_code(code)));
+      ret[idx] = detail::make_recorded_outcome(outcome, outcome_value((*params)[idx]));
+      if(fail_fast && !ret[idx]->passed())
+        cancel.cancel(idx);
+    };
+#ifndef _WIN32
+    detail::signal_recovery_handlers handlers(_options.recover_signals);
+#endif
+    const _timeouts timeouts(_make_timeouts(_options.isolation_timeout, false));
+    fork_server(is_multithreaded ? _options.workers : 1, _options.chunk, std::chrono::milliseconds(0), &cancel)(plan.count(results.size()), execute, complete, died, [&](size_t n) { return timeouts.of(plan.index(n)); });
+    _report_cancelled(cancel, plan.count(results.size()), [&](size_t n) { return !!ret[plan.index(n)]; });
+    _finish(plan, [&](size_t idx) { return ret[idx]; });
+    return ret;
+  }
+
+  /*! Permute the callable f with this parameter permuter like the call operator, but instead of returning
+  the results of every permutation, pass them to `consumer` in order of index a window of
+  `permuter_options::stream_window` permutations at a time, destroying each window of results before
+  executing the next. With a `generated_sequence`, neither the parameter sets nor the results of the
+  whole sequence then ever exist at once.
+
+  Only the permutations of this process' shard are executed and passed to `consumer`. The cost
+  profile and result cache are neither used nor updated, and no shard results file is written, as
+  these would hash and hold something for every permutation of the sequence.
+  \return True if every call of `consumer` returned true.
+  \throws anything Any exception thrown by any call of the callable f or `consumer`
+  \param f Some callable with callspec result(typename ParamSequence::value_type ...)
+  \param consumer Some callable with callspec bool(size_t, const optional<result> &, shouldbe), which
+  could be `pretty_print_failure()` for example.
+  */
+  template <class U, class V> bool stream(U &&f, V &&consumer) const
+  {
+    using return_type = _return_type<U>;
+    const size_t total = _params.size();
+    const size_t window = (_options.stream_window != 0) ? _options.stream_window : 65536;
+    const shard_spec shard = _options.shard.is_sharded() ? _options.shard : shard_spec::from_command_line();
+    streamed_permutation_results_type<return_type> results;
+    _parameter_table_ptr params(_parameter_table());
+    _hook_session_pool_ptr pool(_hook_session_pool());
+    _logs->clear();
+    auto call_f = _make_call_f(f, results, params, pool);
+    std::vector<size_t> order;
+    const bool fail_fast = _fail_fast();
+    cancellation_token cancel;
+    size_t dispatched = 0, ran = 0, base = 0;
+    const _timeouts timeouts(_make_timeouts(std::chrono::milliseconds(0), true));
+    auto dispatch = [&](size_t n) {
+      if(cancel.cancelled())
+        return;
+      const size_t idx = order[n];
+      volatile int stage = 0;
+      _call_with_timeout(f, results, call_f, params, pool, timeouts, idx, stage);
+      if(fail_fast && !detail::check_result(results[idx], outcome_value((*params)[idx])))
+        cancel.cancel(idx);
+    };
+#ifndef _WIN32
+    detail::signal_recovery_handlers handlers(_options.recover_signals);
+#endif
+    bool ret = true;
+    for(; base < total && !cancel.cancelled(); base += window)
+    {
+      const size_t size = std::min(window, total - base);
+      results.reset(base, size);
+      order.clear();
+      for(size_t idx = base; idx < base + size; idx++)
+      {
+        if(shard.runs(idx))
+          order.push_back(idx);
+      }
+      _execute(order.size(), dispatch, false);
+      dispatched += order.size();
+      for(size_t idx : order)
+      {
+        // Permutations cancelled by failing fast are not passed to the consumer
+        if(!results[idx])
+          continue;
+        ran++;
+        const auto &pars = (*params)[idx];
+        detail::checked_row_scope row(this, idx, &pars);
+        if(!consumer(idx, results[idx], outcome_value(pars)))
+          ret = false;
+      }
+    }
+    if(cancel.cancelled())
+    {
+      // Count what the windows never executed would have dispatched
+      for(size_t idx = base; idx < total; idx++)
+      {
+        if(shard.runs(idx))
+          dispatched++;
+      }
+      KERNELTEST_CERR("WARNING: Failing fast after permutation " << cancel.cancelled_by() << " failed, " << (dispatched - ran) << " of " << dispatched << " permutations were not run" << std::endl);
+    }
+    results.reset(total, 0);
+    return ret;
+  }
+
+  /*! Permute the callable f with this parameter permuter like the call operator, but check each outcome
+  against what it should be as soon as the permutation completes, passing it to `fail` or `pass` like `check()`
+  and then destroying it. Only a `check_summary` of the outcomes is kept, so kernels returning handles to
+  resources or large values never have more of those alive at once than there are permutations executing.
+
+  Multithreaded permuters call `fail` and `pass` in order of completion rather than of index, but never
+  concurrently. Permutations which passed in an earlier run of this build are passed to `pass` as their
+  expected outcome if that can be returned as a result, as with the call operator. Afterwards `not_run` is
+  called in order of index for every permutation which was not run.
+  \return A summary of which permutations ran and passed, and the recorded outcomes of those which failed.
+  \throws anything Any exception thrown by any call of the callable f or of the callbacks
+  \param f Some callable with callspec result(typename ParamSequence::value_type ...)
+  \param fail Some callable with callspec bool(size_t, value, shouldbe) called if the outcome does not match
+  \param pass Some callable with callspec bool(size_t, value, shouldbe) called if the outcome matches
+  \param not_run Some callable with callspec bool(size_t, shouldbe) called if the permutation was not run
+  */
+  template <class U, class V, class W, class X> check_summary run_and_check(U &&f, V &&fail, W &&pass, X &&not_run) const
+  {
+    using return_type = _return_type<U>;
+    const size_t total = _params.size();
+    check_summary ret(total);
+    std::mutex lock;
+    _parameter_table_ptr params(_parameter_table());
+    _hook_session_pool_ptr pool(_hook_session_pool());
+    _logs->clear();
+    // Cached permutations can only be reported if their expected outcome can be returned as a result
+    _dispatch_plan plan(_plan(*params, std::is_constructible<return_type, const outcome_type &>::value));
+    for(size_t idx = 0; idx < plan.cached.size(); idx++)
+    {
+      if(!plan.cached[idx])
+        continue;
+      const parameter_sequence_value_type &pars = (*params)[idx];
+      optional<return_type> result;
+      detail::assign_expected_result(result, outcome_value(pars));
+      ret.record_pass(idx);
+      detail::checked_row_scope row(this, idx, &pars);
+      if(!pass(idx, result, outcome_value(pars)))
+        ret.record_not_ok();
+    }
+    const bool fail_fast = _fail_fast();
+    cancellation_token cancel;
+    const _timeouts timeouts(_make_timeouts(std::chrono::milliseconds(0), true));
+    auto dispatch = [&](size_t n) {
+      if(cancel.cancelled())
+        return;
+      const size_t idx = plan.index(n);
+      // The outcome lives only until it has been checked
+      detail::abandonable_permutation<return_type> slot;
+      auto call_f = _make_call_f(f, slot, params, pool);
+      auto begin = std::chrono::steady_clock::now();
+      _call_with_timeout(f, slot, call_f, params, pool, timeouts, idx, slot.stage);
+      if(plan.profile != nullptr)
+      {
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count();
+        plan.nanoseconds[idx] = (elapsed > 0) ? static_cast<uint64_t>(elapsed) : 1;
+      }
+      const parameter_sequence_value_type &pars = (*params)[idx];
+      const outcome_type &shouldbe = outcome_value(pars);
+      const bool passed = detail::check_result(slot.result, shouldbe);
+      if(fail_fast && !passed)
+        cancel.cancel(idx);
+      std::lock_guard<std::mutex> g(lock);
+      if(passed)
+        ret.record_pass(idx);
+      else
+        ret.record_failure(idx, detail::make_recorded_outcome(slot.result, shouldbe));
+      detail::checked_row_scope row(this, idx, &pars);
+      if(!(passed ? pass(idx, slot.result, shouldbe) : fail(idx, slot.result, shouldbe)))
+        ret.record_not_ok();
+    };
+#ifndef _WIN32
+    detail::signal_recovery_handlers handlers(_options.recover_signals);
+#endif
+    _execute(plan.count(total), dispatch, plan.prioritised);
+    _report_cancelled(cancel, plan.count(total), [&](size_t n) { return ret.ran(plan.index(n)); });
+    _finish(plan, [&](size_t idx) -> optional<recorded_outcome> {
+      if(!ret.ran(idx))
+        return {};
+      if(const recorded_outcome *failure = ret.failure(idx))
+        return *failure;
+      // A permutation which passed produced its expected outcome, so record that
+      const parameter_sequence_value_type &pars = (*params)[idx];
+      return detail::make_recorded_outcome(optional<outcome_type>(outcome_value(pars)), outcome_value(pars));
+    });
+    size_t idx = 0;
+    for(const auto &i : _params)
+    {
+      detail::checked_row_scope row(this, idx, &i);
+      if(!ret.ran(idx) && !not_run(idx, outcome_value(i)))
+        ret.record_not_ok();
+      ++idx;
+    }
+    return ret;
+  }
+  //! \overload
+  template <class U, class V, class W> check_summary run_and_check(U &&f, V &&fail, W &&pass) const
+  {
+    return run_and_check(std::forward<U>(f), std::forward<V>(fail), std::forward<W>(pass), [](size_t, const auto &) { return true; });
+  }
+  //! \overload
+  template <class U, class V> check_summary run_and_check(U &&f, V &&fail) const
+  {
+    return run_and_check(std::forward<U>(f), std::forward<V>(fail), [](size_t, const auto &, const auto &) { return true; });
+  }
+
+  /*! Benchmark the callable f with this parameter permuter. Each permutation is executed once like the
+  call operator, and if it produced its expected outcome, executed `benchmark_options::warmup` more times
+  untimed and then repeatedly timed until the `benchmark_options` say its latency is known well enough.
+  Only the call of the kernel is timed, the hooks being set up before and torn down after each timed
+  execution. Permutations are benchmarked one at a time even by multithreaded permuters, so they don't
+  compete with one another for the machine.
+
+  Only the permutations of this process' shard are benchmarked. The cost profile and result cache are
+  neither used nor updated, and no shard results file is written.
+  \return An array or vector of benchmark results, which can be checked and pretty printed like the
+  results of the call operator, `pretty_print_success()` printing the latency distribution of each.
+  An exception thrown while being timed fails the permutation with `kerneltest_errc::setup_exception_thrown`,
+  `kernel_exception_thrown` or `teardown_exception_thrown` depending on where it was thrown, like the call operator.
+  \throws anything Any exception thrown by the first call of the callable f if it isn't caught by the call operator
+  \param f Some callable with callspec result(typename ParamSequence::value_type ...)
+  \param options How to repeat each permutation
+  */
+  template <class U> permutation_results_type<benchmark_result> benchmark(U &&f, const benchmark_options &options = benchmark_options()) const
+  {
+    using return_type = _return_type<U>;
+    using callable_parameters_type = parameter_type<0>;
     permutation_results_type<return_type> results(detail::make_permutation_results_type<permutation_results_type<return_type>>(_params.size()));
-    permutation_results_type<const parameter_sequence_value_type *> params(detail::make_permutation_results_type<permutation_results_type<const parameter_sequence_value_type *>>(_params.size()));
+    _parameter_table_ptr params(_parameter_table());
+    _hook_session_pool_ptr pool(_hook_session_pool());
+    _logs->clear();
+    auto call_f = _make_call_f(f, results, params, pool);
+    permutation_results_type<benchmark_result> ret(detail::make_permutation_results_type<permutation_results_type<benchmark_result>>(_params.size()));
+    const shard_spec shard = _options.shard.is_sharded() ? _options.shard : shard_spec::from_command_line();
+    const detail::benchmark_clock &clock = detail::benchmark_clock::get();
+    auto sessions(detail::make_hook_sessions(_hooks, std::make_index_sequence<sizeof...(Hooks)>()));
+#ifndef _WIN32
+    detail::signal_recovery_handlers handlers(_options.recover_signals);
+#endif
+    for(size_t idx = 0; idx < _params.size(); idx++)
     {
-      auto it(params.begin());
-      for(auto &i : _params)
-        *it++ = &i;
+      if(!shard.runs(idx))
+        continue;
+      volatile int stage = 0;
+      call_f(idx, stage);
+      const parameter_sequence_value_type &pars = (*params)[idx];
+      benchmark_result result;
+      result.outcome = detail::make_recorded_outcome(results[idx], outcome_value(pars));
+      if(result.passed())
+      {
+        const callable_parameters_type &p = parameter_value<0>(pars);
+        detail::latency_sampler sampler(options);
+        int stage = 0;
+        try
+        {
+          for(size_t n = 0; !sampler.done(); n++)
+          {
+            stage = 0;
+            auto hooks(detail::instantiate_hooks(sessions, this, results[idx], idx, pars, std::make_index_sequence<sizeof...(Hooks)>()));
+            (void) hooks;
+            stage = 1;
+            const uint64_t begin = clock.start();
+            auto v = detail::call_f_with_parameters(f, p, std::make_index_sequence<KERNELTEST_V1_NAMESPACE::parameters_size<callable_parameters_type>::value>());
+            const uint64_t end = clock.stop();
+            results[idx] = std::move(v);
+            if(n >= options.warmup)
+              sampler.add(clock.nanoseconds(begin, end));
+            stage = 2;
+          }
+          result.latency = sampler.statistics();
+        }
+        catch(...)
+        {
+          // The permutation failed when repeated, so fails as a whole
+          kerneltest_errc code = kerneltest_errc::setup_exception_thrown;
+          if(1 == stage)
+            code = kerneltest_errc::kernel_exception_thrown;
+          else if(2 == stage)
+            code = kerneltest_errc::teardown_exception_thrown;
+          try
+          {
+            throw;
+          }
+          catch(const std::exception &e)
+          {
+            KERNELTEST_CERR("WARNING: C++ exception thrown '" << e.what() << "' while benchmarking permutation " << idx << std::endl);
+          }
+          catch(...)
+          {
+            KERNELTEST_CERR("WARNING: Unknown exception thrown while benchmarking permutation " << idx << std::endl);
+          }
+          results[idx] = return_type(in_place_type<typename return_type::error_type>, make_error_code(code));
+          result.outcome = detail::make_recorded_outcome(results[idx], outcome_value(pars));
+        }
+      }
+      results[idx].reset();
+      ret[idx] = std::move(result);
     }
-    auto call_f = [&](size_t idx) {
-      int stage = 0;
-      auto nested_f = [&](size_t idx) {
+    return ret;
+  }
+
+private:
+  static constexpr size_t _latency_budget_hook = detail::hook_index<hooks::latency_budget_impl::inst, 0, Hooks...>::value;
+
+  static constexpr size_t _heap_accounting_hook = detail::hook_index<hooks::heap_accounting_impl::inst, 0, Hooks...>::value;
+  static constexpr size_t _performance_counters_hook = detail::hook_index<hooks::performance_counters_impl::inst, 0, Hooks...>::value;
+
+  template <class U> using _return_type = typename detail::result_of_parameter_permute<parameter_sequence_value_type, U>::type;
+
+  // Which permutations this process dispatches, in what order, and what they cost
+  struct _dispatch_plan
+  {
+    const detail::parameter_table<ParamSequence> *params{nullptr};
+    cost_profile *profile{nullptr};
+    result_cache *cache{nullptr};
+    shard_spec shard;
+    std::string kernel_identity;
+    std::vector<uint64_t> hashes, nanoseconds, keys;
+    std::vector<size_t> order;
+    std::vector<char> cached, colliding;
+    uint64_t fingerprint{0};
+    bool reordered{false}, prioritised{false};
+
+    // True if the permutation at idx passed in an earlier run of this build, and so isn't dispatched
+    bool is_cached(size_t idx) const noexcept { return !cached.empty() && cached[idx]; }
+
+    // The number of dispatch positions, and the permutation at position n. Unless reordered,
+    // these are every count'th permutation starting from the index of any shard.
+    size_t count(size_t total) const noexcept { return reordered ? order.size() : shard.run_count(total); }
+    size_t index(size_t n) const noexcept { return reordered ? order[n] : shard.run_index(n); }
+    // The hash of the parameter set of the permutation at idx
+    uint64_t hash(size_t idx) const { return hashes.empty() ? hash_parameter_set((*params)[idx]) : hashes[idx]; }
+  };
+
+  // Returns any latency budget hook, setting budget to the budget of pars
+  const hooks::latency_budget_impl::inst *_latency_budget(const parameter_sequence_value_type &pars, std::chrono::nanoseconds &budget) const { return _latency_budget(pars, budget, std::integral_constant<bool, (_latency_budget_hook < sizeof...(Hooks))>()); }
+  const hooks::latency_budget_impl::inst *_latency_budget(const parameter_sequence_value_type &pars, std::chrono::nanoseconds &budget, std::true_type) const
+  {
+    budget = std::get<0>(std::get<2 + _latency_budget_hook>(pars));
+    return &std::get<_latency_budget_hook>(_hooks);
+  }
+  const hooks::latency_budget_impl::inst *_latency_budget(const parameter_sequence_value_type & /*unused*/, std::chrono::nanoseconds &budget, std::false_type) const
+  {
+    budget = std::chrono::nanoseconds(0);
+    return nullptr;
+  }
+  const hooks::latency_budget_impl::inst *_latency_budget(std::true_type) const { return &std::get<_latency_budget_hook>(_hooks); }
+  const hooks::latency_budget_impl::inst *_latency_budget(std::false_type) const { return nullptr; }
+
+  // Returns any heap accounting hook
+  const hooks::heap_accounting_impl::inst *_heap_accounting(std::true_type) const { return &std::get<_heap_accounting_hook>(_hooks); }
+  const hooks::heap_accounting_impl::inst *_heap_accounting(std::false_type) const { return nullptr; }
+
+  // Returns any performance counters hook
+  const hooks::performance_counters_impl::inst *_performance_counters(std::true_type) const { return &std::get<_performance_counters_hook>(_hooks); }
+  const hooks::performance_counters_impl::inst *_performance_counters(std::false_type) const { return nullptr; }
+
+  // Works out what to do with the output of permutations executed in process
+  log_capture_mode _log_capture_mode() const
+  {
+    if(_options.capture_log != log_capture_mode::automatic)
+      return _options.capture_log;
+    if(!is_multithreaded)
+      return log_capture_mode::off;
+    return !!command_line_option("verbose") ? log_capture_mode::always : log_capture_mode::failures;
+  }
+
+  // Returns a callable executing the permutation at idx into results[idx], publishing its stage as it goes.
+  // If capture_log, its output is captured as permuter_options::capture_log says.
+  template <class U, class Results> auto _make_call_f(U &f, Results &results, const _parameter_table_ptr &params, const _hook_session_pool_ptr &pool, bool capture_log = true) const
+  {
+    using return_type = _return_type<U>;
+    using return_type_as_if_void = typename return_type::template rebind<void>;
+    static_assert(!std::is_void<typename outcome_type::value_type>::value ? (std::is_constructible<outcome_type, return_type>::value) : (std::is_constructible<outcome_type, return_type_as_if_void>::value), "Return type of callable is not compatible with the parameter outcome type");
+    const hooks::performance_counters_impl::inst *counters = _performance_counters(std::integral_constant<bool, (_performance_counters_hook < sizeof...(Hooks))>());
+    const log_capture_mode capture = capture_log ? _log_capture_mode() : log_capture_mode::off;
+    const size_t capture_size = (_options.capture_log_size != 0) ? _options.capture_log_size : 65536;
+    return [this, &f, &results, params, pool, counters, capture, capture_size](size_t idx, volatile int &stage) {
+      stage = 0;
+      // Returns how long the kernel took if timed by clock
+      auto nested_f = [&](typename detail::hook_session_pool<Hooks...>::lease &lease, size_t idx, const parameter_sequence_value_type &pars, const detail::benchmark_clock *clock) -> uint64_t {
         using callable_parameters_type = parameter_type<0>;
-        const callable_parameters_type &p = parameter_value<0>(**params[idx]);
+        const callable_parameters_type &p = parameter_value<0>(pars);
+        uint64_t took = 0;
+        hooks::performance_counts counts;
+        bool counted = false;
         try
         {
           // Instantiate the hooks
-          auto hooks(detail::instantiate_hooks(_hooks, this, results[idx], idx, **params[idx], std::make_index_sequence<sizeof...(Hooks)>()));
+          auto hooks(detail::instantiate_hooks(lease.get(), this, results[idx], idx, pars, std::make_index_sequence<sizeof...(Hooks)>()));
           (void) hooks;
           stage = 1;
           // Call the kernel
-          results[idx] = detail::call_f_with_parameters(std::forward<U>(f), p, std::make_index_sequence<KERNELTEST_V1_NAMESPACE::parameters_size<callable_parameters_type>::value>());
+          if(counters != nullptr)
+            counters->start();
+          const uint64_t begin = (clock != nullptr) ? clock->start() : 0;
+          auto v = detail::call_f_with_parameters(f, p, std::make_index_sequence<KERNELTEST_V1_NAMESPACE::parameters_size<callable_parameters_type>::value>());
+          if(clock != nullptr)
+            took = clock->nanoseconds(begin, clock->stop());
+          if(counters != nullptr)
+          {
+            counts = counters->stop();
+            counted = true;
+          }
+          results[idx] = std::move(v);
           stage = 2;
         }
         catch(...)
@@ -349,87 +1289,442 @@ public:
           }
 #endif
         }
+        // Recorded once the hooks are torn down, so any heap accounting doesn't see the table of counts grow
+        if(counted)
+          counters->record(idx, counts);
+        return took;
       };
-//! \todo Need to install signal handlers for each permutation execution thread somehow
-#if 0  // def _WIN32
-      __try
-      {
+      // Executes the permutation, and if it overran any latency budget it has, again up to the remeasurements of the budget
+      auto budgeted_f = [&](size_t idx) {
+        // If the parameter sequence is generated, this is where the parameter set gets generated
+        const parameter_sequence_value_type &pars = (*params)[idx];
+        // Leased here so a signal recovered from abandons the sessions with everything else
+        auto lease(pool->acquire());
+        std::chrono::nanoseconds budget(0);
+        const hooks::latency_budget_impl::inst *hook = _latency_budget(pars, budget);
+        if(hook == nullptr || budget.count() == 0)
+        {
+          nested_f(lease, idx, pars, nullptr);
+          return;
+        }
+        // Calibrated by the first call in the process, which must not be timed with the kernel
+        const detail::benchmark_clock &clock = detail::benchmark_clock::get();
+        uint64_t took = nested_f(lease, idx, pars, &clock);
+        for(size_t n = 0; took > static_cast<uint64_t>(budget.count()) && n < hook->remeasurements && detail::check_result(results[idx], outcome_value(pars)); n++)
+          took = std::min(took, nested_f(lease, idx, pars, &clock));
+        if(took > static_cast<uint64_t>(budget.count()) && detail::check_result(results[idx], outcome_value(pars)))
+        {
+          const hooks::latency_budget_overrun overrun{std::chrono::nanoseconds(took), budget};
+          hook->record(idx, &overrun);
+          results[idx] = return_type(in_place_type<typename return_type::error_type>, make_error_code(kerneltest_errc::latency_budget_exceeded));
+        }
+        else
+          hook->record(idx, nullptr);
+      };
+      // Executes the permutation, recovering from any fatal signal it raises
+      auto recovered_f = [&] {
+#ifndef _WIN32
+        if(_options.recover_signals)
+        {
+          // A fatal signal raised by the permutation returns here from sigsetjmp() with the signal number.
+          // Anything the permutation had constructed is abandoned, including the hooks, which don't get torn down.
+          sigjmp_buf recovery;
+          detail::signal_recovery_scope scope(&recovery);
+          int signo = sigsetjmp(recovery, 1);
+          if(signo == 0)
+            budgeted_f(idx);
+          else
+          {
+            kerneltest_errc code = kerneltest_errc::setup_signal_thrown;
+            if(1 == stage)
+              code = kerneltest_errc::kernel_signal_thrown;
+            else if(2 == stage)
+              code = kerneltest_errc::teardown_signal_thrown;
+            KERNELTEST_CERR("WARNING: Signal " << signo << " raised by permutation " << idx << std::endl);
+            results[idx] = return_type(in_place_type<typename return_type::error_type>, make_error_code(code));
+          }
+          return;
+        }
 #endif
-      nested_f(idx);
-#if 0  // def _WIN32
+        budgeted_f(idx);
+      };
+      if(capture == log_capture_mode::off)
+      {
+        recovered_f();
+        return;
+      }
+      detail::permutation_log_scope log(capture_size);
+      recovered_f();
+      if(!log.active())
+        return;
+      std::string output(log.finish());
+      if(!output.empty() && (capture == log_capture_mode::always || !detail::check_result(results[idx], outcome_value((*params)[idx]))))
+        _logs->keep(idx, std::move(output));
+      else
+        _logs->forget(idx);
+    };
+  }
+
+  // The timeouts of one execution of the parameter sequence
+  struct _timeouts
+  {
+    std::chrono::milliseconds fallback{0};
+    const std::function<std::chrono::milliseconds(size_t)> *row{nullptr};
+    std::unique_ptr<detail::permutation_watchdog> watchdog;
+    bool abandon{false};
+
+    bool any() const noexcept { return fallback.count() != 0 || row != nullptr; }
+    std::chrono::milliseconds of(size_t idx) const
+    {
+      if(row != nullptr)
+      {
+        auto ret = (*row)(idx);
+        if(ret.count() != 0)
+          return ret;
+      }
+      return fallback;
     }
-#if 0  // def _MSC_VER
-#pragma warning(push)
-#pragma warning(disable : 6320)  // SA warning about catching all exceptions
-#endif
-    __except(EXCEPTION_EXECUTE_HANDLER)
+  };
+  // Works out the timeouts, starting a watchdog if they are to be enforced in process without abandoning
+  _timeouts _make_timeouts(std::chrono::milliseconds fallback, bool in_process) const
+  {
+    _timeouts ret;
+    ret.fallback = (fallback.count() != 0) ? fallback : _options.timeout;
+    if(ret.fallback.count() == 0)
     {
-      kerneltest_errc code = kerneltest_errc::setup_seh_exception_thrown;
-      if(1 == stage)
-        code = kerneltest_errc::kernel_seh_exception_thrown;
-      else if(2 == stage)
-        code = kerneltest_errc::teardown_seh_exception_thrown;
-      results[idx] = {make_error_code(code)};
+      auto option = command_line_option("timeout");
+      if(option && !option->empty())
+        ret.fallback = std::chrono::milliseconds(std::stoull(*option));
     }
-#ifdef _MSC_VER
-#pragma warning(pop)
-#endif
-#endif
-    };
-#ifdef _OPENMP
-    if(is_multithreaded)
+    if(_options.row_timeout)
+      ret.row = &_options.row_timeout;
+    ret.abandon = _options.abandon_timed_out;
+    if(in_process && ret.any() && !ret.abandon)
+      ret.watchdog.reset(new detail::permutation_watchdog);
+    return ret;
+  }
+
+  // Executes the permutation at idx into results[idx] like call_f, failing it if it overruns its timeout
+  template <class U, class Results, class CallF> void _call_with_timeout(U &f, Results &results, CallF &call_f, const _parameter_table_ptr &params, const _hook_session_pool_ptr &pool, const _timeouts &timeouts, size_t idx, volatile int &stage) const
+  {
+    using return_type = _return_type<U>;
+    const std::chrono::milliseconds timeout = timeouts.any() ? timeouts.of(idx) : std::chrono::milliseconds(0);
+    if(timeout.count() == 0)
     {
-#pragma omp parallel for
-      for(size_t n = 0; n < results.size(); n++)
-        call_f(n);
+      call_f(idx, stage);
+      return;
     }
-    else
-#endif
+    if(timeouts.abandon)
     {
-      for(size_t n = 0; n < results.size(); n++)
-        call_f(n);
+      // The job owns everything the permutation writes, so it can be left to finish by itself
+      static QUICKCPPLIB_THREAD_LOCAL detail::abandonable_runner runner;
+      auto job = std::make_shared<detail::abandonable_permutation<return_type>>();
+      auto job_call_f = _make_call_f(f, *job, params, pool);
+      const current_test_kernel_t caller_test_kernel = current_test_kernel;
+      if(runner.run(
+         [job, job_call_f, caller_test_kernel, idx]() mutable {
+           current_test_kernel = caller_test_kernel;
+           job_call_f(idx, job->stage);
+         },
+         std::chrono::steady_clock::now() + timeout))
+      {
+        results[idx] = std::move(job->result);
+        return;
+      }
+      KERNELTEST_CERR("WARNING: Permutation " << idx << " exceeded its timeout of " << timeout.count() << " ms, abandoning its thread" << std::endl);
+      results[idx] = return_type(in_place_type<typename return_type::error_type>, make_error_code(detail::timed_out_code(job->stage)));
+      return;
     }
-    return results;
+    detail::permutation_watchdog::entry e(idx, timeout, &stage);
+    timeouts.watchdog->add(e);
+    call_f(idx, stage);
+    if(timeouts.watchdog->remove(e))
+      results[idx] = return_type(in_place_type<typename return_type::error_type>, make_error_code(detail::timed_out_code(e.overdue_stage)));
+  }
+
+  // Works out which permutations to dispatch in what order. If profiling, the permutations are
+  // dispatched longest first, and if sharded, only the permutations of this shard are dispatched.
+  // If cacheable, permutations which passed in an earlier run of this build are not dispatched.
+  // Sharding alone needs nothing per permutation, but profiling and caching hash every parameter set.
+  _dispatch_plan _plan(const detail::parameter_table<ParamSequence> &params, bool cacheable) const
+  {
+    _dispatch_plan plan;
+    plan.params = &params;
+    plan.profile = cost_profile::open(_options.cost_profile_path);
+    if(cacheable)
+      plan.cache = result_cache::open(_options.result_cache_path);
+    plan.shard = _options.shard.is_sharded() ? _options.shard : shard_spec::from_command_line();
+    if(plan.profile != nullptr || plan.cache != nullptr || plan.shard.is_sharded())
+      plan.kernel_identity = detail::current_test_kernel_identity();
+    if(plan.profile != nullptr || plan.cache != nullptr)
+    {
+      if(detail::is_generated_sequence<ParamSequence>::value && _params.size() >= detail::large_generated_sequence)
+        KERNELTEST_CERR("WARNING: The cost profile and result cache hash all " << _params.size() << " permutations of a generated parameter sequence up front, which takes time and memory in proportion to its length" << std::endl);
+      plan.hashes.reserve(_params.size());
+      for(const auto &i : _params)
+        plan.hashes.push_back(hash_parameter_set(i));
+    }
+    if(plan.profile != nullptr)
+    {
+      if(plan.profile->costs(plan.kernel_identity, plan.hashes, plan.nanoseconds) && is_multithreaded)
+      {
+        plan.order = detail::longest_first_order(plan.nanoseconds);
+        plan.reordered = plan.prioritised = true;
+      }
+      std::fill(plan.nanoseconds.begin(), plan.nanoseconds.end(), 0);
+    }
+    if(plan.shard.is_sharded() && plan.reordered)
+      plan.order.erase(std::remove_if(plan.order.begin(), plan.order.end(), [&](size_t idx) { return !plan.shard.runs(idx); }), plan.order.end());
+    if(plan.cache != nullptr)
+    {
+      plan.fingerprint = result_cache::fingerprint(_options.cache_dependencies);
+      plan.keys.reserve(_params.size());
+      for(const auto &i : _params)
+        plan.keys.push_back(detail::result_cache_key(plan.hashes[plan.keys.size()], _describe_expected(i)));
+      // Permutations sharing a key with another are neither skipped nor recorded, as which passed can't be told
+      plan.colliding = detail::colliding_result_cache_keys(plan.keys);
+      plan.cache->lookup(plan.kernel_identity, plan.keys, plan.fingerprint, plan.cached);
+      bool any_cached = false;
+      for(size_t idx = 0; idx < plan.cached.size(); idx++)
+      {
+        if(plan.colliding[idx])
+          plan.cached[idx] = 0;
+        any_cached = any_cached || plan.cached[idx];
+      }
+      if(any_cached)
+      {
+        if(!plan.reordered)
+        {
+          plan.order.resize(plan.count(_params.size()));
+          for(size_t n = 0; n < plan.order.size(); n++)
+            plan.order[n] = plan.index(n);
+          plan.reordered = true;
+        }
+        const size_t before = plan.order.size();
+        plan.order.erase(std::remove_if(plan.order.begin(), plan.order.end(), [&](size_t idx) { return plan.is_cached(idx); }), plan.order.end());
+        KERNELTEST_COUT((before - plan.order.size()) << " of " << before << " permutations passed in an earlier run of this build and will not be executed again" << std::endl);
+      }
+    }
+    return plan;
+  }
+
+  // The printed form of the expected outcome of the permutation with parameter set pars
+  std::string _describe_expected(const parameter_sequence_value_type &pars) const
+  {
+    return detail::make_recorded_outcome(optional<outcome_type>(outcome_value(pars)), outcome_value(pars)).description();
   }
 
+  // Returns the table indexing the parameter sets of one execution of the parameter sequence
+  _parameter_table_ptr _parameter_table() const { return std::make_shared<const detail::parameter_table<ParamSequence>>(_params); }
+  // Returns the pool of hook sessions of one execution of the parameter sequence, so the sessions are made once per worker
+  _hook_session_pool_ptr _hook_session_pool() const { return std::make_shared<detail::hook_session_pool<Hooks...>>(_hooks); }
+
+  // Records the costs and cacheable outcomes of the permutations dispatched, and if this process runs a
+  // shard, its results file. record(idx) returns the recorded outcome of the permutation at idx if it ran.
+  template <class F> void _finish(const _dispatch_plan &plan, F &&record) const
+  {
+    if(plan.profile != nullptr)
+      plan.profile->record(plan.kernel_identity, plan.hashes, plan.nanoseconds);
+    if(plan.cache != nullptr)
+    {
+      std::vector<signed char> outcomes(_params.size(), -1);
+      for(size_t n = 0; n < plan.count(_params.size()); n++)
+      {
+        const size_t idx = plan.index(n);
+        if(plan.colliding[idx])
+          continue;
+        optional<recorded_outcome> outcome(record(idx));
+        if(outcome)
+          outcomes[idx] = outcome->passed() ? 1 : 0;
+      }
+      plan.cache->record(plan.kernel_identity, plan.keys, plan.fingerprint, outcomes);
+    }
+    if(plan.shard.is_sharded() && !plan.shard.merge)
+    {
+      std::vector<detail::shard_record> records;
+      records.reserve(plan.shard.run_count(_params.size()));
+      for(size_t n = 0; n < plan.shard.run_count(_params.size()); n++)
+      {
+        const size_t idx = plan.shard.run_index(n);
+        optional<recorded_outcome> outcome(record(idx));
+        if(outcome)
+          records.push_back({idx, plan.hash(idx), std::move(*outcome)});
+      }
+      detail::write_shard_results(detail::shard_results_path(_options.shard_directory, plan.shard.index, plan.shard.count), plan.kernel_identity, _params.size(), records);
+    }
+  }
+
+  // True if the first permutation not producing its expected outcome should cancel the rest
+  bool _fail_fast() const { return _options.fail_fast || !!command_line_option("fail-fast"); }
+
+  // If failing fast cancelled the dispatch, says which permutation failed and how many of the
+  // count dispatch positions were not run. ran(n) returns true if position n was run.
+  template <class F> void _report_cancelled(const cancellation_token &cancel, size_t count, F &&ran) const
+  {
+    if(!cancel.cancelled())
+      return;
+    size_t not_run = 0;
+    for(size_t n = 0; n < count; n++)
+    {
+      if(!ran(n))
+        not_run++;
+    }
+    KERNELTEST_CERR("WARNING: Failing fast after permutation " << cancel.cancelled_by() << " failed, " << not_run << " of " << count << " permutations were not run" << std::endl);
+  }
+
+  // The CPUs the options or the command line pin the worker threads to, if any
+  worker_affinity _worker_affinity() const
+  {
+    if(_options.affinity.enabled())
+      return _options.affinity;
+    return worker_affinity::from_command_line();
+  }
+
+  // Calls f(n) for every n in [0, count) using the executor chosen by the options.
+  // If prioritised, lower n should be started before higher n.
+  template <class F> void _execute(size_t count, F &f, bool prioritised) const
+  {
+    const worker_affinity affinity(_worker_affinity());
+    if(is_multithreaded)
+    {
+#ifdef _OPENMP
+      if(_options.executor != permuter_executor::thread_pool && !affinity.enabled())
+      {
+        const current_test_kernel_t caller_test_kernel = current_test_kernel;
+        const int threads = (_options.workers != 0) ? static_cast<int>(_options.workers) : omp_get_max_threads();
+#pragma omp parallel for schedule(dynamic) num_threads(threads)
+        for(ptrdiff_t n = 0; n < static_cast<ptrdiff_t>(count); n++)
+        {
+          current_test_kernel = caller_test_kernel;
+          f(static_cast<size_t>(n));
+        }
+        current_test_kernel = caller_test_kernel;
+        return;
+      }
+#endif
+      work_stealing_executor(_options.workers, _options.chunk, prioritised, &affinity)(count, f);
+      return;
+    }
+    detail::worker_affinity_scope pin(&affinity, 0);
+    for(size_t n = 0; n < count; n++)
+      f(n);
+  }
+
+  // Checks one outcome against what it should be, calling the appropriate callable
+  template <class T, class V, class W, class X> bool _check_one(size_t idx, const T &outcome, const parameter_sequence_value_type &pars, V &fail, W &pass, X &not_run) const
+  {
+    detail::checked_row_scope row(this, idx, &pars);
+    const outcome_type &shouldbe = outcome_value(pars);
+    if(!outcome)
+      return not_run(idx, shouldbe);
+    if(detail::check_result(outcome, shouldbe))
+      return pass(idx, outcome, shouldbe);
+    return fail(idx, outcome, shouldbe);
+  }
+
+public:
   /*! Checks a sequence of results against what they ought to be, calling the callable f with the results
   \return True if all the results match
   \throws invalid_argument If the results passed is not of the same length as the parameter permute sequence
   \param results A sequence of results to check
   \param fail Some callable with callspec bool(size_t, value, shouldbe) called if the values do not match
   \param pass Some callable with callspec bool(size_t, value, shouldbe) called if the values match
+  \param not_run Some callable with callspec bool(size_t, shouldbe) called if the result is empty because
+  the permutation was not run, for example because it belongs to another shard
   */
-  template <class U, class V, class W, typename std::enable_if<QUICKCPPLIB_NAMESPACE::type_traits::is_sequence<U>::value, bool>::type = true> bool check(U &&sequence, V &&fail, W &&pass) const
+  template <class U, class V, class W, class X, typename std::enable_if<QUICKCPPLIB_NAMESPACE::type_traits::is_sequence<U>::value, bool>::type = true> bool check(U &&sequence, V &&fail, W &&pass, X &&not_run) const
   {
     if(sequence.size() != _params.size())
       throw std::invalid_argument("sequence to check does not have same length as parameter permute sequence");
     bool ret = true;
     auto it(sequence.cbegin());
     size_t idx = 0;
-    for(auto &i : _params)
+    for(const auto &i : _params)
     {
-      const outcome_type &shouldbe = outcome_value(i);
-      const auto &outcome = *it;
-      if(detail::check_result(outcome, shouldbe))
-      {
-        if(!pass(idx, outcome, shouldbe))
-          ret = false;
-      }
-      else
-      {
-        if(!fail(idx, outcome, shouldbe))
-          ret = false;
-      }
+      if(!_check_one(idx, *it, i, fail, pass, not_run))
+        ret = false;
       ++it;
       ++idx;
     }
     return ret;
   }
   //! \overload
+  template <class U, class V, class W, typename std::enable_if<QUICKCPPLIB_NAMESPACE::type_traits::is_sequence<U>::value, bool>::type = true> bool check(U &&sequence, V &&fail, W &&pass) const
+  {
+    return check(std::forward<U>(sequence), std::forward<V>(fail), std::forward<W>(pass), [](size_t, const auto &) { return true; });
+  }
+  //! \overload
   template <class U, class V> bool check(U &&sequence, V &&fail) const
   {
     return check(std::forward<U>(sequence), std::forward<V>(fail), [](size_t, const auto &, const auto &) { return true; });
   }
+
+  /*! Checks a sequence of results against what they ought to be like `check()`, but compares them and calls
+  the callables on `permuter_options::workers` worker threads, so the callables must be safe to call concurrently.
+  What the pretty printers print is buffered per permutation and written in index order, so the output is the
+  same as that of `check()`. The results are checked `permuter_options::stream_window` at a time, which bounds
+  the memory held by the buffers. On Windows, where console colours are not escape sequences, the output is
+  not coloured.
+  \return True if all the results match
+  \throws invalid_argument If the results passed is not of the same length as the parameter permute sequence
+  \param results A sequence of results to check
+  \param fail Some callable with callspec bool(size_t, value, shouldbe) called if the values do not match
+  \param pass Some callable with callspec bool(size_t, value, shouldbe) called if the values match
+  \param not_run Some callable with callspec bool(size_t, shouldbe) called if the result is empty because
+  the permutation was not run
+  */
+  template <class U, class V, class W, class X, typename std::enable_if<QUICKCPPLIB_NAMESPACE::type_traits::is_sequence<U>::value, bool>::type = true> bool parallel_check(U &&sequence, V &&fail, W &&pass, X &&not_run) const
+  {
+    if(sequence.size() != _params.size())
+      throw std::invalid_argument("sequence to check does not have same length as parameter permute sequence");
+    const size_t total = _params.size();
+    const size_t window = (_options.stream_window != 0) ? _options.stream_window : 65536;
+    const worker_affinity affinity(_worker_affinity());
+    const _parameter_table_ptr params(_parameter_table());
+    std::atomic<bool> ret(true);
+    std::vector<decltype(sequence.cbegin())> positions;
+    std::vector<std::string> buffers;
+    auto it(sequence.cbegin());
+    for(size_t begin = 0; begin < total; begin += window)
+    {
+      const size_t count = std::min(window, total - begin);
+      positions.clear();
+      for(size_t n = 0; n < count; n++, ++it)
+        positions.push_back(it);
+      buffers.assign(count, std::string());
+      auto check_f = [&](size_t n) {
+        const size_t idx = begin + n;
+        std::ostringstream s;
+        {
+          detail::pretty_print_capture_scope capture(s);
+          const auto &pars = (*params)[idx];
+          if(!_check_one(idx, *positions[n], pars, fail, pass, not_run))
+            ret = false;
+        }
+        buffers[n] = s.str();
+      };
+      work_stealing_executor(_options.workers, _options.chunk, false, &affinity)(count, check_f);
+      for(const auto &i : buffers)
+      {
+        if(!i.empty())
+        {
+          KERNELTEST_COUT(i);
+        }
+      }
+      KERNELTEST_COUT(std::flush);
+    }
+    return ret;
+  }
+  //! \overload
+  template <class U, class V, class W, typename std::enable_if<QUICKCPPLIB_NAMESPACE::type_traits::is_sequence<U>::value, bool>::type = true> bool parallel_check(U &&sequence, V &&fail, W &&pass) const
+  {
+    return parallel_check(std::forward<U>(sequence), std::forward<V>(fail), std::forward<W>(pass), [](size_t, const auto &) { return true; });
+  }
+  //! \overload
+  template <class U, class V> bool parallel_check(U &&sequence, V &&fail) const
+  {
+    return parallel_check(std::forward<U>(sequence), std::forward<V>(fail), [](size_t, const auto &, const auto &) { return true; });
+  }
 };
 
 namespace detail
@@ -460,6 +1755,21 @@ template <class... Parameters, size_t N, class... Hooks> constexpr auto st_permu
   // Convert C type arrays into std::array
   return parameter_permuter<false, std::array<parameters<Parameters...>, N>, Hooks...>(detail::array_from_Carray<parameters<Parameters...>, N>(seq, std::make_index_sequence<N>()), std::tuple<Hooks...>(std::forward<Hooks>(hooks)...));
 }
+//! \overload
+template <class... Parameters, size_t N, class... Hooks> constexpr auto st_permute_parameters(const std::array<parameters<Parameters...>, N> &seq, Hooks &&... hooks)
+{
+  return parameter_permuter<false, std::array<parameters<Parameters...>, N>, Hooks...>(std::array<parameters<Parameters...>, N>(seq), std::tuple<Hooks...>(std::forward<Hooks>(hooks)...));
+}
+//! \overload
+template <class T, class... Hooks> auto st_permute_parameters(covering_array<T> seq, Hooks &&... hooks)
+{
+  return parameter_permuter<false, covering_array<T>, Hooks...>(std::move(seq), std::tuple<Hooks...>(std::forward<Hooks>(hooks)...));
+}
+//! \overload
+template <class T, class Generator, class... Hooks> constexpr auto st_permute_parameters(generated_sequence<T, Generator> seq, Hooks &&... hooks)
+{
+  return parameter_permuter<false, generated_sequence<T, Generator>, Hooks...>(std::move(seq), std::tuple<Hooks...>(std::forward<Hooks>(hooks)...));
+}
 
 /*! \brief Create a multithreaded parameter permuter
 \tparam OutcomeType An outcome<T>, result<T> or option<T> for the outcome of the test kernel
@@ -478,6 +1788,21 @@ template <class... Parameters, size_t N, class... Hooks> constexpr auto mt_permu
   // Convert C type arrays into std::array
   return parameter_permuter<true, std::array<parameters<Parameters...>, N>, Hooks...>(detail::array_from_Carray<parameters<Parameters...>, N>(seq, std::make_index_sequence<N>()), std::tuple<Hooks...>(std::forward<Hooks>(hooks)...));
 }
+//! \overload
+template <class... Parameters, size_t N, class... Hooks> constexpr auto mt_permute_parameters(const std::array<parameters<Parameters...>, N> &seq, Hooks &&... hooks)
+{
+  return parameter_permuter<true, std::array<parameters<Parameters...>, N>, Hooks...>(std::array<parameters<Parameters...>, N>(seq), std::tuple<Hooks...>(std::forward<Hooks>(hooks)...));
+}
+//! \overload
+template <class T, class... Hooks> auto mt_permute_parameters(covering_array<T> seq, Hooks &&... hooks)
+{
+  return parameter_permuter<true, covering_array<T>, Hooks...>(std::move(seq), std::tuple<Hooks...>(std::forward<Hooks>(hooks)...));
+}
+//! \overload
+template <class T, class Generator, class... Hooks> constexpr auto mt_permute_parameters(generated_sequence<T, Generator> seq, Hooks &&... hooks)
+{
+  return parameter_permuter<true, generated_sequence<T, Generator>, Hooks...>(std::move(seq), std::tuple<Hooks...>(std::forward<Hooks>(hooks)...));
+}
 
 namespace detail
 {
@@ -485,28 +1810,56 @@ namespace detail
 #pragma warning(push)
 #pragma warning(disable : 4127)  // conditional expression is constant
 #endif
+  // Streams by calling f with the stream, so formatting happens directly into whatever KERNELTEST_COUT writes to
+  template <class F> struct deferred_print
+  {
+    F f;
+    friend std::ostream &operator<<(std::ostream &s, const deferred_print &v)
+    {
+      v.f(s);
+      return s;
+    }
+  };
+  // Prints the row formatted by f(std::ostream &), flushing once per row rather than once per line
+  template <class F> void pretty_print_row(F &&f)
+  {
+    std::ostream *capture = pretty_print_capture();
+    if(capture != nullptr)
+    {
+      f(*capture);
+      return;
+    }
+    KERNELTEST_COUT(deferred_print<F &>{f} << std::flush);
+  }
+
   class _print_params
   {
-    template <bool first> static void _do() {}
-    template <bool first, class T, class... Types> static void _do(T &&v, Types &&... vs)
+    std::ostream &_s;
+    template <bool first> void _do() const {}
+    template <bool first, class T, class... Types> void _do(T &&v, Types &&... vs) const
     {
       if(!first)
-        KERNELTEST_COUT(", ");
-      KERNELTEST_COUT(v);
+        _s << ", ";
+      _s << v;
       _do<false>(std::forward<Types>(vs)...);
     };
 
   public:
+    explicit _print_params(std::ostream &s)
+        : _s(s)
+    {
+    }
     template <class... Types> void operator()(Types &&... vs) const { _do<true>(std::forward<Types>(vs)...); }
   };
   template <class Permuter> class _print_hook
   {
+    std::ostream &_s;
     const typename Permuter::parameter_sequence_value_type &_v;
     template <size_t Idx> void _do() const {}
     template <size_t Idx, class T, class... Types> void _do(T &&v, Types &&... vs) const
     {
       if(Idx > 0)
-        KERNELTEST_COUT(", ");
+        _s << ", ";
       // Fetch the hook parameter set for this hook
       using hook_pars_type = typename Permuter::template parameter_type<1 + Idx>;
       //#ifdef __c2__  // c2 be buggy
@@ -516,39 +1869,81 @@ namespace detail
       //#endif
       // Each hook instantiator exposes a member function print(...) which takes
       // the same args as the hook instance
-      detail::call_f_with_parameters([&v](const auto &... vs) { KERNELTEST_COUT(v.print(vs...)); }, hook_pars, std::make_index_sequence<parameters_size<hook_pars_type>::value>());
+      std::ostream &s = _s;
+      detail::call_f_with_parameters([&s, &v](const auto &... vs) { s << v.print(vs...); }, hook_pars, std::make_index_sequence<parameters_size<hook_pars_type>::value>());
       _do<Idx + 1>(std::forward<Types>(vs)...);
     };
 
   public:
-    _print_hook(const typename Permuter::parameter_sequence_value_type &v)
-        : _v(v)
+    _print_hook(std::ostream &s, const typename Permuter::parameter_sequence_value_type &v)
+        : _s(s)
+        , _v(v)
     {
     }
     template <class... Types> void operator()(Types &&... vs) const { _do<0>(std::forward<Types>(vs)...); }
   };
-  template <class Permuter> void pretty_print_preamble(const Permuter &_permuter, size_t idx)
+  template <class Permuter> void pretty_print_preamble(std::ostream &s, const Permuter &_permuter, size_t idx)
   {
     using namespace QUICKCPPLIB_NAMESPACE::console_colours;
-    KERNELTEST_COUT("  " << yellow << (idx + 1) << "/" << _permuter.parameter_sequence().size() << ": " << normal);
-    auto parameter_sequence_item_it = _permuter.parameter_sequence().cbegin();
-    std::advance(parameter_sequence_item_it, idx);
+    s << "  " << yellow << (idx + 1) << "/" << _permuter.parameter_sequence().size() << ": " << normal;
+    // The permutation being checked was already found by the checker. Otherwise walk to it, which is
+    // slow for sequences without random access. Generated parameter sequences return their items by value.
+    const auto *checked = detail::checked_parameters(_permuter, idx);
+    const auto &item = (checked != nullptr) ? *checked : detail::parameter_at(_permuter.parameter_sequence(), idx);
     // Print kernel parameters we called the kernel with
     {
-      KERNELTEST_COUT("kernel(");
-      const auto &pars = std::get<1>(*parameter_sequence_item_it);
+      s << "kernel(";
+      const auto &pars = std::get<1>(item);
       using pars_type = typename std::decay<decltype(pars)>::type;
-      detail::call_f_with_parameters(_print_params(), pars, std::make_index_sequence<parameters_size<pars_type>::value>());
-      KERNELTEST_COUT(")");
+      detail::call_f_with_parameters(_print_params(s), pars, std::make_index_sequence<parameters_size<pars_type>::value>());
+      s << ")";
     }
     // If there are any hooks, print those
     if(Permuter::hook_sequence_size > 0)
     {
-      KERNELTEST_COUT(" with ");
+      s << " with ";
       const auto &hooks = _permuter.hooks();
-      detail::call_f_with_tuple(_print_hook<Permuter>(*parameter_sequence_item_it), hooks, std::make_index_sequence<Permuter::hook_sequence_size>());
+      detail::call_f_with_tuple(_print_hook<Permuter>(s, item), hooks, std::make_index_sequence<Permuter::hook_sequence_size>());
+    }
+    s << "\n";
+  }
+  template <class Permuter> void pretty_print_preamble(const Permuter &_permuter, size_t idx)
+  {
+    pretty_print_row([&](std::ostream &s) { pretty_print_preamble(s, _permuter, idx); });
+  }
+
+  // Prints whatever the hooks measured of the permutation at idx
+  template <class Permuter> void pretty_print_measurements(std::ostream &s, const Permuter &_permuter, size_t idx)
+  {
+    hooks::performance_counts counts;
+    if(_permuter.performance_counts(idx, counts))
+      s << "    " << hooks::print(counts) << "\n";
+    hooks::heap_usage usage;
+    if(_permuter.heap_usage(idx, usage))
+      s << "    " << hooks::print(usage) << "\n";
+  }
+  template <class Permuter> void pretty_print_measurements(const Permuter &_permuter, size_t idx)
+  {
+    pretty_print_row([&](std::ostream &s) { pretty_print_measurements(s, _permuter, idx); });
+  }
+
+  // Prints any output captured of the permutation at idx, indented
+  template <class Permuter> void pretty_print_captured_log(std::ostream &s, const Permuter &_permuter, size_t idx)
+  {
+    std::string log;
+    if(!_permuter.captured_log(idx, log))
+      return;
+    size_t begin = 0;
+    while(begin < log.size())
+    {
+      size_t end = log.find('\n', begin);
+      if(end == std::string::npos)
+        end = log.size();
+      s << "    | ";
+      s.write(log.data() + begin, static_cast<std::streamsize>(end - begin));
+      s << "\n";
+      begin = end + 1;
     }
-    KERNELTEST_COUT("\n");
   }
 
   template <class Permuter, class U> class pretty_print_failure_impl
@@ -565,9 +1960,16 @@ namespace detail
     }
     template <class _T, class _U> bool operator()(size_t idx, const _T &result, const _U &shouldbe) const
     {
-      using namespace QUICKCPPLIB_NAMESPACE::console_colours;
-      pretty_print_preamble(_permuter, idx);
-      KERNELTEST_COUT("    " << bold << red << "FAILED" << normal << " (should be " << bold << print(shouldbe) << normal << ", was " << bold << print(result.value()) << normal << ")" << std::endl);
+      pretty_print_row([&](std::ostream &s) {
+        using namespace QUICKCPPLIB_NAMESPACE::console_colours;
+        pretty_print_preamble(s, _permuter, idx);
+        s << "    " << bold << red << "FAILED" << normal << " (should be " << bold << print(shouldbe) << normal << ", was " << bold << print(result.value()) << normal << ")\n";
+        hooks::latency_budget_overrun overrun;
+        if(_permuter.latency_budget_overran(idx, overrun))
+          s << "    took " << bold << overrun.took.count() << " ns" << normal << ", latency budget is " << bold << overrun.budget.count() << " ns" << normal << "\n";
+        pretty_print_measurements(s, _permuter, idx);
+        pretty_print_captured_log(s, _permuter, idx);
+      });
       _f(result, shouldbe);
       return false;
     }
@@ -586,13 +1988,36 @@ namespace detail
     }
     template <class _T, class _U> bool operator()(size_t idx, const _T &result, const _U &shouldbe) const
     {
-      using namespace QUICKCPPLIB_NAMESPACE::console_colours;
-      pretty_print_preamble(_permuter, idx);
-      KERNELTEST_COUT("    " << bold << green << "PASSED " << normal << print(result.value()) << std::endl);
+      pretty_print_row([&](std::ostream &s) {
+        using namespace QUICKCPPLIB_NAMESPACE::console_colours;
+        pretty_print_preamble(s, _permuter, idx);
+        s << "    " << bold << green << "PASSED " << normal << print(result.value()) << "\n";
+        pretty_print_measurements(s, _permuter, idx);
+        pretty_print_captured_log(s, _permuter, idx);
+      });
       _f(result, shouldbe);
       return true;
     }
   };
+  template <class Permuter> class pretty_print_not_run_impl
+  {
+    const Permuter &_permuter;
+
+  public:
+    pretty_print_not_run_impl(const Permuter &permuter)
+        : _permuter(permuter)
+    {
+    }
+    template <class _U> bool operator()(size_t idx, const _U &shouldbe) const
+    {
+      pretty_print_row([&](std::ostream &s) {
+        using namespace QUICKCPPLIB_NAMESPACE::console_colours;
+        pretty_print_preamble(s, _permuter, idx);
+        s << "    " << bold << yellow << "NOT RUN" << normal << " (should be " << bold << print(shouldbe) << normal << ")\n";
+      });
+      return true;
+    }
+  };
 #ifdef _MSC_VER
 #pragma warning(pop)
 #endif
@@ -617,19 +2042,117 @@ template <class Permuter> auto pretty_print_success(const Permuter &s)
 {
   return pretty_print_success(s, [](const auto &, const auto &) {});
 }
+//! Colourfully prints a result which was not run
+template <class Permuter> detail::pretty_print_not_run_impl<Permuter> pretty_print_not_run(const Permuter &s)
+{
+  return detail::pretty_print_not_run_impl<Permuter>(s);
+}
 
+/*! \brief Reads the results files written by every shard of the parameter sequence of `permuter`,
+returning the combined recorded outcomes in the same shape as the results returned by the permuter.
+These can be passed to `parameter_permuter::check()` and the pretty printers as if all the shards had
+been run by this process. Permutations of any shard whose results file is missing are left empty, and
+so are reported as not run.
+\throws std::runtime_error If a results file is corrupt, or was written for a different parameter sequence.
+\param permuter The permuter whose parameter sequence was sharded.
+\param count The number of shards. Zero means the count of `permuter.options().shard`, or of the command line.
+\param directory The directory containing the results files. Empty means `permuter.options().shard_directory`.
+*/
+template <class Permuter> inline auto merge_shard_results(const Permuter &permuter, size_t count = 0, filesystem::path directory = {})
+{
+  using results_type = typename Permuter::template permutation_results_type<recorded_outcome>;
+  const auto &seq = permuter.parameter_sequence();
+  results_type ret(detail::make_permutation_results_type<results_type>(seq.size()));
+  if(count == 0)
+    count = permuter.options().shard.is_sharded() ? permuter.options().shard.count : shard_spec::from_command_line().count;
+  if(directory.empty())
+    directory = permuter.options().shard_directory;
+  // Only the parameter sets of the permutations read back are hashed
+  const detail::parameter_table<typename Permuter::parameter_sequence_type> params(seq);
+  const std::string identity = detail::current_test_kernel_identity();
+  std::vector<detail::shard_record> records;
+  for(size_t index = 0; index < count; index++)
+  {
+    const filesystem::path path = detail::shard_results_path(directory, index, count);
+    if(!detail::read_shard_results(path, identity, seq.size(), records))
+    {
+      KERNELTEST_CERR("WARNING: Shard results " << path << " are missing, its permutations will be reported as not run" << std::endl);
+      continue;
+    }
+    for(auto &i : records)
+    {
+      if(i.hash != hash_parameter_set(params[static_cast<size_t>(i.index)]))
+        throw std::runtime_error("shard results " + path.string() + " do not match the parameter sequence");
+      ret[static_cast<size_t>(i.index)] = std::move(i.outcome);
+    }
+  }
+  return ret;
+}
 
-//! Do a normal permuter.check, but also call BOOST_CHECK() on every single result
+/*! \brief Writes the counts of every permutation of `permuter` counted by its `hooks::performance_counters`
+as CSV to `s`, one line per permutation after a header line. Each line is the index of the permutation, the
+hash of its parameter set from `hash_parameter_set()`, the source of the counts, and the counts, with those
+not counted by that source left empty. Permutations not executed by this process are omitted.
+*/
+template <class Permuter> inline void write_performance_counts(const Permuter &permuter, std::ostream &s)
+{
+  s << "index,hash,source,cycles,instructions,cache_misses,branch_misses,page_faults,context_switches\n";
+  const auto &seq = permuter.parameter_sequence();
+  size_t idx = 0;
+  for(auto it = seq.cbegin(); it != seq.cend(); ++it, ++idx)
+  {
+    hooks::performance_counts counts;
+    if(!permuter.performance_counts(idx, counts))
+      continue;
+    s << idx << ',' << std::hex << hash_parameter_set(*it) << std::dec << ',' << hooks::to_string(counts.source) << ',';
+    if(counts.source == hooks::performance_counts::source_type::hardware)
+      s << counts.cycles << ',' << counts.instructions << ',' << counts.cache_misses << ',' << counts.branch_misses << ',';
+    else
+      s << ",,,,";
+    if(counts.source != hooks::performance_counts::source_type::none)
+      s << counts.page_faults << ',' << counts.context_switches;
+    else
+      s << ',';
+    s << '\n';
+  }
+}
+
+
+namespace detail
+{
+  template <class Permuter, class Results> inline void check_results_with_boost_test(const Permuter &permuter, const Results &results)
+  {
+    // Note that we accumulate failures into the checks vector for later processing
+    std::vector<std::function<void()>> checks;
+    size_t not_run = 0;
+    bool all_passed = permuter.check(results, pretty_print_failure(permuter, [&checks](const auto &result, const auto &shouldbe) { checks.push_back([&] { BOOST_CHECK(detail::compare(result.value(), shouldbe)); }); }), pretty_print_success(permuter), [&not_run](size_t, const auto &) {
+      ++not_run;
+      return true;
+    });
+    if(not_run > 0)
+    {
+      KERNELTEST_COUT("  " << not_run << " of " << permuter.parameter_sequence().size() << " permutations were not run" << std::endl);
+    }
+    BOOST_CHECK(all_passed);
+    // The pretty printing gets messed up by the unit test output, so defer telling it
+    // about failures until now
+    for(auto &i : checks)
+      i();
+  }
+}  // namespace detail
+
+/*! Do a normal permuter.check, but also call BOOST_CHECK() on every single result. If this process
+is merging the results of shards, the merged results of all the shards are checked instead.
+*/
 template <class Permuter, class Results> inline void check_results_with_boost_test(const Permuter &permuter, const Results &results)
 {
-  // Note that we accumulate failures into the checks vector for later processing
-  std::vector<std::function<void()>> checks;
-  bool all_passed = permuter.check(results, pretty_print_failure(permuter, [&checks](const auto &result, const auto &shouldbe) { checks.push_back([&] { BOOST_CHECK(detail::compare(result.value(), shouldbe)); }); }), pretty_print_success(permuter));
-  BOOST_CHECK(all_passed);
-  // The pretty printing gets messed up by the unit test output, so defer telling it
-  // about failures until now
-  for(auto &i : checks)
-    i();
+  const shard_spec shard = permuter.options().shard.is_sharded() ? permuter.options().shard : shard_spec::from_command_line();
+  if(shard.is_sharded() && shard.merge)
+  {
+    detail::check_results_with_boost_test(permuter, merge_shard_results(permuter, shard.count));
+    return;
+  }
+  detail::check_results_with_boost_test(permuter, results);
 }
 
 /*! If expr is false, sets testreturn to an error_code_extended of `kerneltest_errc::check_failed` with an extended message of the expr which failed
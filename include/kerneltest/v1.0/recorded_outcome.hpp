@@ -0,0 +1,183 @@
+/* Recorded outcomes of permutations
+(C) 2026 agent <agent@local>
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#include "config.hpp"
+
+#ifndef KERNELTEST_RECORDED_OUTCOME_HPP
+#define KERNELTEST_RECORDED_OUTCOME_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <string>
+
+KERNELTEST_V1_NAMESPACE_BEGIN
+
+/*! \brief A compact, serialisable record of the outcome of a permutation.
+
+The outcome returned by a test kernel can be of any type, and usually cannot leave the
+process which created it. A recorded outcome instead keeps whether the outcome matched what
+it should have been, whether it was a value, error or exception, any error code, and the
+printed form of the outcome. Sequences of `optional<recorded_outcome>` can be passed to
+`parameter_permuter::check()` and the pretty printers just like the results returned by
+the permuter.
+*/
+class recorded_outcome
+{
+public:
+  //! What the outcome contained
+  enum class state_type : unsigned char
+  {
+    value = 0,
+    error = 1,
+    exception = 2
+  };
+  //! The category of any error code, if it is one which can be reconstructed
+  enum class category_type : unsigned char
+  {
+    none = 0,
+    generic = 1,
+    system = 2,
+    kerneltest = 3,
+    other = 4
+  };
+
+private:
+  bool _passed{false};
+  state_type _state{state_type::value};
+  category_type _category{category_type::none};
+  int64_t _code{0};
+  std::string _description;
+
+public:
+  //! Default constructs an instance
+  recorded_outcome() = default;
+  //! Constructs an instance
+  recorded_outcome(bool passed, state_type state, category_type category, int64_t code, std::string description)
+      : _passed(passed)
+      , _state(state)
+      , _category(category)
+      , _code(code)
+      , _description(std::move(description))
+  {
+  }
+
+  //! True if the outcome matched what it should have been
+  bool passed() const noexcept { return _passed; }
+  //! What the outcome contained
+  state_type state() const noexcept { return _state; }
+  //! True if the outcome contained a value
+  bool has_value() const noexcept { return _state == state_type::value; }
+  //! True if the outcome contained an error
+  bool has_error() const noexcept { return _state == state_type::error; }
+  //! True if the outcome contained an exception
+  bool has_exception() const noexcept { return _state == state_type::exception; }
+  //! The category of any error code
+  category_type category() const noexcept { return _category; }
+  //! The value of any error code
+  int64_t code() const noexcept { return _code; }
+  //! The printed form of the outcome
+  const std::string &description() const noexcept { return _description; }
+
+#if !KERNELTEST_EXPERIMENTAL_STATUS_CODE
+  //! The error code, if the outcome was errored with a code in a category which can be reconstructed. Otherwise empty.
+  std::error_code error_code() const
+  {
+    switch(_category)
+    {
+    case category_type::generic:
+      return {static_cast<int>(_code), std::generic_category()};
+    case category_type::system:
+      return {static_cast<int>(_code), std::system_category()};
+    case category_type::kerneltest:
+      return {static_cast<int>(_code), kerneltest_category()};
+    default:
+      return {};
+    }
+  }
+#endif
+
+  //! Writes a binary representation of this record, returning false if the stream failed
+  bool write(std::ostream &s) const
+  {
+    const unsigned char header[3] = {static_cast<unsigned char>(_passed), static_cast<unsigned char>(_state), static_cast<unsigned char>(_category)};
+    const uint32_t length = static_cast<uint32_t>(_description.size());
+    s.write(reinterpret_cast<const char *>(header), sizeof(header));
+    s.write(reinterpret_cast<const char *>(&_code), sizeof(_code));
+    s.write(reinterpret_cast<const char *>(&length), sizeof(length));
+    s.write(_description.data(), length);
+    return !!s;
+  }
+  //! Reads a binary representation written by `write()`, returning false if the stream failed or was corrupt
+  bool read(std::istream &s)
+  {
+    unsigned char header[3];
+    uint32_t length = 0;
+    s.read(reinterpret_cast<char *>(header), sizeof(header));
+    s.read(reinterpret_cast<char *>(&_code), sizeof(_code));
+    s.read(reinterpret_cast<char *>(&length), sizeof(length));
+    if(!s || header[0] > 1 || header[1] > 2 || header[2] > 4 || length > (1U << 24))
+      return false;
+    _passed = header[0] != 0;
+    _state = static_cast<state_type>(header[1]);
+    _category = static_cast<category_type>(header[2]);
+    _description.resize(length);
+    if(length > 0)
+      s.read(&_description[0], length);
+    return !!s;
+  }
+};
+
+//! Returns the printed form of a recorded outcome
+inline std::string print(const recorded_outcome &v)
+{
+  return v.description();
+}
+//! Prints a recorded outcome
+inline std::ostream &operator<<(std::ostream &s, const recorded_outcome &v)
+{
+  return s << v.description();
+}
+
+namespace detail
+{
+  // The permutation was checked when it was recorded, so just report that
+  template <class T> inline bool check_result(const optional<recorded_outcome> &kernel_outcome, const T & /*unused*/) { return kernel_outcome.value().passed(); }
+  template <class T> inline bool compare(const recorded_outcome &a, const T & /*unused*/) { return a.passed(); }
+
+  template <class T, class = void> struct is_ostreamable : std::false_type
+  {
+  };
+  template <class T> struct is_ostreamable<T, decltype((void) (std::declval<std::ostream &>() << std::declval<const T &>()))> : std::true_type
+  {
+  };
+  template <> struct is_ostreamable<void, void> : std::true_type
+  {
+  };
+}  // namespace detail
+
+KERNELTEST_V1_NAMESPACE_END
+
+#endif
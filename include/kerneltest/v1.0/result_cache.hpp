@@ -0,0 +1,316 @@
+/* Cache of permutations which passed in earlier runs of the same build
+(C) 2026 agent <agent@local>
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#include "config.hpp"
+
+#ifndef KERNELTEST_RESULT_CACHE_HPP
+#define KERNELTEST_RESULT_CACHE_HPP
+
+#include "command_line.hpp"
+#include "parameter_hash.hpp"
+#include "shared_file.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__linux__)
+#include <link.h>
+#elif defined(__APPLE__)
+#include <mach-o/dyld.h>
+#endif
+
+KERNELTEST_V1_NAMESPACE_BEGIN
+
+namespace detail
+{
+  // Hashes the size and last write time of the file at path, if it exists
+  inline void hash_file_stamp(fnv1a_hasher &h, const filesystem::path &path)
+  {
+    std::error_code ec;
+    const auto size = filesystem::file_size(path, ec);
+    if(ec)
+      return;
+    const auto stamp = filesystem::last_write_time(path, ec).time_since_epoch().count();
+    h(&size, sizeof(size));
+    h(&stamp, sizeof(stamp));
+  }
+
+#if defined(__linux__)
+  struct build_id_search
+  {
+    const std::vector<std::string> *dependencies;
+    fnv1a_hasher *h;
+  };
+  // Hashes the GNU build ID note of the executable and of every loaded library named in the dependencies.
+  // Modules linked without a build ID fall back to the size and last write time of their file.
+  inline int hash_build_id(struct dl_phdr_info *info, size_t, void *data)
+  {
+    auto *search = static_cast<build_id_search *>(data);
+    const bool executable = (info->dlpi_name == nullptr || info->dlpi_name[0] == 0);
+    if(!executable)
+    {
+      bool listed = false;
+      for(const auto &i : *search->dependencies)
+      {
+        if(strstr(info->dlpi_name, i.c_str()) != nullptr)
+          listed = true;
+      }
+      if(!listed)
+        return 0;
+    }
+    for(int n = 0; n < info->dlpi_phnum; n++)
+    {
+      const auto &phdr = info->dlpi_phdr[n];
+      if(phdr.p_type != PT_NOTE)
+        continue;
+      const char *p = reinterpret_cast<const char *>(info->dlpi_addr + phdr.p_vaddr), *end = p + phdr.p_memsz;
+      while(p + sizeof(ElfW(Nhdr)) <= end)
+      {
+        const auto *note = reinterpret_cast<const ElfW(Nhdr) *>(p);
+        const char *name = p + sizeof(ElfW(Nhdr));
+        const char *desc = name + ((note->n_namesz + 3) & ~3u);
+        if(note->n_type == NT_GNU_BUILD_ID && note->n_namesz == 4 && memcmp(name, "GNU", 4) == 0)
+        {
+          (*search->h)(desc, note->n_descsz);
+          return 0;
+        }
+        p = desc + ((note->n_descsz + 3) & ~3u);
+      }
+    }
+    hash_file_stamp(*search->h, executable ? filesystem::path("/proc/self/exe") : filesystem::path(info->dlpi_name));
+    return 0;
+  }
+#endif
+
+  // The key of a permutation in the result cache, which changes if its parameters or expected outcome do
+  inline uint64_t result_cache_key(uint64_t parameter_hash, const std::string &expected)
+  {
+    fnv1a_hasher h;
+    h(&parameter_hash, sizeof(parameter_hash));
+    h(expected.data(), expected.size());
+    return h.state;
+  }
+  // Which of keys are shared with another permutation, whose outcomes can't be told apart by the result cache
+  inline std::vector<char> colliding_result_cache_keys(const std::vector<uint64_t> &keys)
+  {
+    std::unordered_map<uint64_t, size_t> counts;
+    for(uint64_t key : keys)
+      counts[key]++;
+    std::vector<char> ret(keys.size(), 0);
+    for(size_t n = 0; n < keys.size(); n++)
+      ret[n] = counts[keys[n]] > 1;
+    return ret;
+  }
+}  // namespace detail
+
+/*! \brief A persisted record of which permutations of each test kernel passed in which build of the test
+program, so that later runs of an unchanged build can skip them.
+
+Each permutation is keyed by the hash of its parameter set from `hash_parameter_set()` and the printed form of
+its expected outcome, and each key records the `fingerprint()` of the build it last passed in. A permutation is
+reported as passed from the cache only if the build has the same fingerprint, so rebuilding the test program or
+any listed dependency library reruns everything. Failures are never cached, and nor are permutations whose
+parameter sets and expected outcomes are the same as another's, as which of them passed can't be told apart.
+
+The cache file is plain text, one line per permutation, each line being the test kernel identity, the key and
+the fingerprint, separated by tabs.
+*/
+class result_cache
+{
+  mutable std::mutex _lock;
+  filesystem::path _path;
+  std::unordered_map<std::string, std::unordered_map<uint64_t, uint64_t>> _passed;
+
+  void _load()
+  {
+    std::ifstream s(_path);
+    std::string line;
+    while(std::getline(s, line))
+    {
+      auto tab2 = line.rfind('\t');
+      if(tab2 == std::string::npos || tab2 == 0)
+        continue;
+      auto tab1 = line.rfind('\t', tab2 - 1);
+      if(tab1 == std::string::npos)
+        continue;
+      uint64_t key = strtoull(line.c_str() + tab1 + 1, nullptr, 16);
+      uint64_t fingerprint = strtoull(line.c_str() + tab2 + 1, nullptr, 16);
+      _passed[line.substr(0, tab1)][key] = fingerprint;
+    }
+  }
+
+public:
+  //! Constructs an instance, loading any existing cache file at `path`
+  explicit result_cache(filesystem::path path)
+      : _path(std::move(path))
+  {
+    _load();
+  }
+  result_cache(const result_cache &) = delete;
+  result_cache &operator=(const result_cache &) = delete;
+
+  /*! Returns the process wide instance for the cache file at `path`, loading it if necessary.
+  If `path` is empty, the environment variable `KERNELTEST_RESULT_CACHE` is used instead, and if
+  that is not set either, a null pointer is returned. A null pointer is also returned if
+  `--kerneltest-no-cache` is on the command line, or the `KERNELTEST_NO_CACHE` environment variable is set.
+  */
+  static result_cache *open(filesystem::path path = {})
+  {
+    if(command_line_option("no-cache"))
+      return nullptr;
+    if(path.empty())
+    {
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4996)  // Stupid deprecation warning
+#endif
+      auto env = getenv("KERNELTEST_RESULT_CACHE");
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+      if(env == nullptr || env[0] == 0)
+        return nullptr;
+      path = env;
+    }
+    static std::mutex lock;
+    static std::unordered_map<filesystem::path, std::unique_ptr<result_cache>, path_hasher> caches;
+    std::lock_guard<std::mutex> g(lock);
+    auto &ret = caches[path];
+    if(!ret)
+      ret.reset(new result_cache(path));
+    return ret.get();
+  }
+
+  /*! Returns the fingerprint of this build of the test program and of the loaded shared libraries whose
+  file names contain any of `dependencies`. On ELF platforms this hashes their GNU build IDs, elsewhere, or for
+  modules linked without one, the size and last write time of the executable, and of each dependency treated as a path.
+  */
+  static uint64_t fingerprint(const std::vector<std::string> &dependencies)
+  {
+    detail::fnv1a_hasher h;
+#if defined(__linux__)
+    detail::build_id_search search{&dependencies, &h};
+    dl_iterate_phdr(detail::hash_build_id, &search);
+#else
+#if defined(_WIN32)
+    wchar_t buffer[32768];
+    DWORD length = GetModuleFileNameW(nullptr, buffer, 32768);
+    detail::hash_file_stamp(h, filesystem::path(std::wstring(buffer, length)));
+#elif defined(__APPLE__)
+    char buffer[4096];
+    uint32_t length = sizeof(buffer);
+    if(_NSGetExecutablePath(buffer, &length) == 0)
+      detail::hash_file_stamp(h, filesystem::path(buffer));
+#endif
+    for(const auto &i : dependencies)
+      detail::hash_file_stamp(h, filesystem::path(i));
+#endif
+    return h.state;
+  }
+
+  //! The path of the cache file
+  const filesystem::path &path() const noexcept { return _path; }
+
+  //! Fills `passed` with whether each of `keys` for `kernel` passed in a build with `fingerprint`. Returns true if any did.
+  bool lookup(const std::string &kernel, const std::vector<uint64_t> &keys, uint64_t fingerprint, std::vector<char> &passed) const
+  {
+    std::lock_guard<std::mutex> g(_lock);
+    passed.assign(keys.size(), 0);
+    auto it = _passed.find(kernel);
+    if(it == _passed.end())
+      return false;
+    bool ret = false;
+    for(size_t n = 0; n < keys.size(); n++)
+    {
+      auto i = it->second.find(keys[n]);
+      if(i != it->second.end() && i->second == fingerprint)
+        passed[n] = ret = true;
+    }
+    return ret;
+  }
+
+  /*! Records whether each of `keys` for `kernel` passed in the build with `fingerprint`, and rewrites the
+  cache file. `outcomes[n]` is 1 if passed, 0 if failed and -1 if not run, which leaves its entry alone.
+  A key appearing more than once has not passed if any of its outcomes is a failure.
+  The cache file is locked and read again first, so the results recorded by other processes sharing it are kept.
+  */
+  void record(const std::string &kernel, const std::vector<uint64_t> &keys, uint64_t fingerprint, const std::vector<signed char> &outcomes)
+  {
+    std::lock_guard<std::mutex> g(_lock);
+    detail::shared_file_lock locked(_path);
+    // What is in the file wins over what was loaded, as another process may have since failed a permutation
+    _passed.clear();
+    _load();
+    auto &passed = _passed[kernel];
+    for(size_t n = 0; n < keys.size(); n++)
+    {
+      if(outcomes[n] > 0)
+        passed[keys[n]] = fingerprint;
+    }
+    for(size_t n = 0; n < keys.size(); n++)
+    {
+      if(outcomes[n] == 0)
+        passed.erase(keys[n]);
+    }
+    // Write a new file and atomically rename it over the old one, so
+    // a concurrent reader never sees a partially written cache
+    const filesystem::path temp(detail::shared_file_temporary_path(_path));
+    {
+      std::ofstream s(temp, std::ios::trunc);
+      for(auto &k : _passed)
+      {
+        for(auto &i : k.second)
+          s << k.first << '\t' << std::hex << i.first << '\t' << i.second << std::dec << '\n';
+      }
+      if(!s)
+      {
+        KERNELTEST_CERR("WARNING: Couldn't write result cache " << temp << std::endl);
+        s.close();
+        std::error_code ec;
+        filesystem::remove(temp, ec);
+        return;
+      }
+    }
+    std::error_code ec;
+    filesystem::rename(temp, _path, ec);
+    if(ec)
+    {
+      KERNELTEST_CERR("WARNING: Couldn't replace result cache " << _path << " due to " << ec.message() << std::endl);
+      filesystem::remove(temp, ec);
+    }
+  }
+};
+
+KERNELTEST_V1_NAMESPACE_END
+
+#endif
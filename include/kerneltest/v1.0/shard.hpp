@@ -0,0 +1,192 @@
+/* Multi process sharding of parameter sequences
+(C) 2026 agent <agent@local>
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#include "config.hpp"
+
+#ifndef KERNELTEST_SHARD_HPP
+#define KERNELTEST_SHARD_HPP
+
+#include "command_line.hpp"
+#include "recorded_outcome.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+KERNELTEST_V1_NAMESPACE_BEGIN
+
+/*! \brief Which shard of a parameter sequence a process runs.
+
+Shard `index` of `count` runs every permutation whose index modulo `count` is `index`,
+and writes their recorded outcomes to a shard results file. A merging process runs no
+permutations, instead reading the results files of all `count` shards.
+*/
+struct shard_spec
+{
+  size_t index{0};  //!< The shard this process runs
+  size_t count{0};  //!< The number of shards. Zero or one means the parameter sequence is not sharded.
+  bool merge{false};  //!< True if this process merges the results of all the shards instead of running one
+
+  //! True if the parameter sequence is sharded
+  bool is_sharded() const noexcept { return count > 1; }
+  //! True if this process runs the permutation at `idx`
+  bool runs(size_t idx) const noexcept { return !is_sharded() || (!merge && idx % count == index); }
+  //! The number of the `total` permutations of the parameter sequence which this process runs
+  size_t run_count(size_t total) const noexcept
+  {
+    if(!is_sharded())
+      return total;
+    return (merge || index >= total) ? 0 : (total - index - 1) / count + 1;
+  }
+  //! The index of the `n`th permutation which this process runs
+  size_t run_index(size_t n) const noexcept { return is_sharded() ? index + n * count : n; }
+
+  /*! Returns the shard specified by `--kerneltest-shard=i/n` or `--kerneltest-shard=merge/n` on the command
+  line, or by the `KERNELTEST_SHARD` environment variable. Not sharded if neither is present.
+  \throws std::invalid_argument If the specification is malformed.
+  */
+  static shard_spec from_command_line()
+  {
+    shard_spec ret;
+    auto option = command_line_option("shard");
+    if(!option || option->empty())
+      return ret;
+    auto slash = option->find('/');
+    if(slash == std::string::npos)
+      throw std::invalid_argument("--kerneltest-shard must be i/n or merge/n");
+    auto first = option->substr(0, slash);
+    ret.count = std::stoul(option->substr(slash + 1));
+    if(first == "merge")
+      ret.merge = true;
+    else
+      ret.index = std::stoul(first);
+    if(ret.count == 0 || ret.index >= ret.count)
+      throw std::invalid_argument("--kerneltest-shard index must be less than the number of shards");
+    return ret;
+  }
+};
+
+namespace detail
+{
+  static constexpr char shard_results_magic[8] = {'K', 'T', 'S', 'H', 'A', 'R', 'D', '1'};
+
+  // The results file of shard index of count for the current test kernel in directory
+  inline filesystem::path shard_results_path(filesystem::path directory, size_t index, size_t count)
+  {
+    if(directory.empty())
+      directory = filesystem::current_path();
+    std::string leaf = current_test_kernel_identity();
+    for(auto &c : leaf)
+    {
+      if(c == '/' || c == '\\' || c == ':')
+        c = '_';
+    }
+    leaf.append(".shard" + std::to_string(index) + "of" + std::to_string(count) + ".ktr");
+    return directory / leaf;
+  }
+
+  //! The recorded outcome of the permutation at `index`, whose parameter set has hash `hash`
+  struct shard_record
+  {
+    uint64_t index{0}, hash{0};
+    recorded_outcome outcome;
+  };
+
+  /* Shard results files are the magic, the test kernel identity, the length of the parameter
+  sequence and the number of records, then per record the index of the permutation, the hash of
+  its parameter set and the recorded outcome.
+  */
+  inline void write_shard_results(const filesystem::path &path, const std::string &identity, uint64_t total, const std::vector<shard_record> &records)
+  {
+    filesystem::path temp(path);
+    temp += ".tmp";
+    {
+      std::ofstream s(temp, std::ios::binary | std::ios::trunc);
+      const uint32_t identity_length = static_cast<uint32_t>(identity.size());
+      const uint64_t count = records.size();
+      s.write(shard_results_magic, sizeof(shard_results_magic));
+      s.write(reinterpret_cast<const char *>(&identity_length), sizeof(identity_length));
+      s.write(identity.data(), identity_length);
+      s.write(reinterpret_cast<const char *>(&total), sizeof(total));
+      s.write(reinterpret_cast<const char *>(&count), sizeof(count));
+      for(const auto &i : records)
+      {
+        s.write(reinterpret_cast<const char *>(&i.index), sizeof(i.index));
+        s.write(reinterpret_cast<const char *>(&i.hash), sizeof(i.hash));
+        i.outcome.write(s);
+      }
+      if(!s)
+      {
+        KERNELTEST_CERR("WARNING: Couldn't write shard results " << temp << std::endl);
+        return;
+      }
+    }
+    std::error_code ec;
+    filesystem::rename(temp, path, ec);
+    if(ec)
+    {
+      KERNELTEST_CERR("WARNING: Couldn't replace shard results " << path << " due to " << ec.message() << std::endl);
+    }
+  }
+
+  /* Reads the records of a shard results file, returning false if it does not exist.
+  Throws std::runtime_error if it is corrupt or not for identity and total.
+  */
+  inline bool read_shard_results(const filesystem::path &path, const std::string &identity, uint64_t total, std::vector<shard_record> &records)
+  {
+    records.clear();
+    std::ifstream s(path, std::ios::binary);
+    if(!s)
+      return false;
+    auto corrupt = [&] { return std::runtime_error("shard results " + path.string() + " are corrupt or do not match the parameter sequence"); };
+    char magic[sizeof(shard_results_magic)];
+    uint32_t identity_length = 0;
+    uint64_t _total = 0, count = 0;
+    s.read(magic, sizeof(magic));
+    s.read(reinterpret_cast<char *>(&identity_length), sizeof(identity_length));
+    if(!s || memcmp(magic, shard_results_magic, sizeof(magic)) != 0 || identity_length != identity.size())
+      throw corrupt();
+    std::string _identity(identity_length, 0);
+    s.read(&_identity[0], identity_length);
+    s.read(reinterpret_cast<char *>(&_total), sizeof(_total));
+    s.read(reinterpret_cast<char *>(&count), sizeof(count));
+    if(!s || _identity != identity || _total != total || count > total)
+      throw corrupt();
+    records.resize(static_cast<size_t>(count));
+    for(auto &i : records)
+    {
+      s.read(reinterpret_cast<char *>(&i.index), sizeof(i.index));
+      s.read(reinterpret_cast<char *>(&i.hash), sizeof(i.hash));
+      if(!s || i.index >= total || !i.outcome.read(s))
+        throw corrupt();
+    }
+    return true;
+  }
+}  // namespace detail
+
+KERNELTEST_V1_NAMESPACE_END
+
+#endif
@@ -0,0 +1,123 @@
+/* Updating files shared by many processes
+(C) 2026 agent <agent@local>
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#include "config.hpp"
+
+#ifndef KERNELTEST_SHARED_FILE_HPP
+#define KERNELTEST_SHARED_FILE_HPP
+
+#include <atomic>
+#include <cstring>
+#include <string>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+KERNELTEST_V1_NAMESPACE_BEGIN
+
+namespace detail
+{
+  /* An exclusive lock on the file at path, held until destruction, so processes sharing the file, for
+  example the shards of a test run, take turns to read, modify and rewrite it. The lock is taken on a
+  lock file next to it, as the file itself is replaced by renaming. If the lock file can't be opened,
+  nothing is locked.
+  */
+  class shared_file_lock
+  {
+#ifdef _WIN32
+    HANDLE _h{INVALID_HANDLE_VALUE};
+#else
+    int _fd{-1};
+#endif
+
+  public:
+    explicit shared_file_lock(const filesystem::path &path)
+    {
+      filesystem::path lockpath(path);
+      lockpath += ".lock";
+#ifdef _WIN32
+      _h = CreateFileW(lockpath.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+      if(_h == INVALID_HANDLE_VALUE)
+        return;
+      OVERLAPPED ol;
+      memset(&ol, 0, sizeof(ol));
+      if(!LockFileEx(_h, LOCKFILE_EXCLUSIVE_LOCK, 0, MAXDWORD, MAXDWORD, &ol))
+      {
+        CloseHandle(_h);
+        _h = INVALID_HANDLE_VALUE;
+      }
+#else
+      _fd = ::open(lockpath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0666);
+      if(_fd < 0)
+        return;
+      while(::flock(_fd, LOCK_EX) < 0)
+      {
+        if(errno != EINTR)
+        {
+          ::close(_fd);
+          _fd = -1;
+          return;
+        }
+      }
+#endif
+    }
+    shared_file_lock(const shared_file_lock &) = delete;
+    shared_file_lock &operator=(const shared_file_lock &) = delete;
+    ~shared_file_lock()
+    {
+#ifdef _WIN32
+      // Closing the handle releases the lock
+      if(_h != INVALID_HANDLE_VALUE)
+        CloseHandle(_h);
+#else
+      if(_fd >= 0)
+        ::close(_fd);
+#endif
+    }
+  };
+
+  // Returns a name next to path for a temporary file, unique to this process and call, to write and then rename over path
+  inline filesystem::path shared_file_temporary_path(const filesystem::path &path)
+  {
+    static std::atomic<unsigned> count(0);
+#ifdef _WIN32
+    const unsigned long pid = GetCurrentProcessId();
+#else
+    const long pid = static_cast<long>(getpid());
+#endif
+    filesystem::path ret(path);
+    ret += "." + std::to_string(pid) + "." + std::to_string(count++) + ".tmp";
+    return ret;
+  }
+}  // namespace detail
+
+KERNELTEST_V1_NAMESPACE_END
+
+#endif
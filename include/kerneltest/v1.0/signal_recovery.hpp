@@ -0,0 +1,200 @@
+/* In process recovery from signals raised by permutations
+(C) 2026 agent <agent@local>
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#include "config.hpp"
+
+#ifndef KERNELTEST_SIGNAL_RECOVERY_HPP
+#define KERNELTEST_SIGNAL_RECOVERY_HPP
+
+#ifndef _WIN32
+#include <algorithm>
+#include <csetjmp>
+#include <csignal>
+#include <cstring>
+#include <memory>
+#include <mutex>
+
+KERNELTEST_V1_NAMESPACE_BEGIN
+
+namespace detail
+{
+  // The signals raised synchronously by a faulting permutation which we recover from
+  static constexpr int signal_recovery_signals[] = {SIGSEGV, SIGBUS, SIGFPE, SIGILL};
+  static constexpr size_t signal_recovery_signals_count = sizeof(signal_recovery_signals) / sizeof(signal_recovery_signals[0]);
+
+  // The recovery point of the permutation executing on this thread, if any. This is a
+  // trivial thread local so the signal handler can read it without initialisation.
+  inline sigjmp_buf *&signal_recovery_point() noexcept
+  {
+    static QUICKCPPLIB_THREAD_LOCAL sigjmp_buf *v;
+    return v;
+  }
+  // The handlers which were installed before ours
+  inline struct sigaction *signal_recovery_previous() noexcept
+  {
+    static struct sigaction v[signal_recovery_signals_count];
+    return v;
+  }
+
+  inline void signal_recovery_handler(int signo, siginfo_t *info, void *context)
+  {
+    sigjmp_buf *point = signal_recovery_point();
+    if(point != nullptr)
+    {
+      signal_recovery_point() = nullptr;
+      siglongjmp(*point, signo);
+    }
+    // Not inside a permutation, so do whatever would have been done without us
+    for(size_t n = 0; n < signal_recovery_signals_count; n++)
+    {
+      if(signal_recovery_signals[n] != signo)
+        continue;
+      const struct sigaction &previous = signal_recovery_previous()[n];
+      if((previous.sa_flags & SA_SIGINFO) != 0)
+      {
+        if(previous.sa_sigaction != nullptr)
+          previous.sa_sigaction(signo, info, context);
+      }
+      else if(previous.sa_handler == SIG_DFL)
+      {
+        // Delivered again with the default action once this handler returns
+        ::signal(signo, SIG_DFL);
+        ::raise(signo);
+      }
+      else if(previous.sa_handler != SIG_IGN)
+        previous.sa_handler(signo);
+      return;
+    }
+  }
+
+  /* If enabled, installs the signal handlers for the lifetime of the instance. Instances nest,
+  the handlers which were installed before the outermost instance being restored when it
+  is destroyed.
+  */
+  class signal_recovery_handlers
+  {
+    bool _enabled;
+
+    static std::mutex &_lock() noexcept
+    {
+      static std::mutex v;
+      return v;
+    }
+    static size_t &_count() noexcept
+    {
+      static size_t v;
+      return v;
+    }
+
+  public:
+    explicit signal_recovery_handlers(bool enabled)
+        : _enabled(enabled)
+    {
+      if(!_enabled)
+        return;
+      std::lock_guard<std::mutex> g(_lock());
+      if(_count()++ > 0)
+        return;
+      struct sigaction sa;
+      memset(&sa, 0, sizeof(sa));
+      sa.sa_sigaction = signal_recovery_handler;
+      sa.sa_flags = SA_SIGINFO | SA_ONSTACK;
+      sigemptyset(&sa.sa_mask);
+      for(size_t n = 0; n < signal_recovery_signals_count; n++)
+        sigaction(signal_recovery_signals[n], &sa, &signal_recovery_previous()[n]);
+    }
+    signal_recovery_handlers(const signal_recovery_handlers &) = delete;
+    signal_recovery_handlers &operator=(const signal_recovery_handlers &) = delete;
+    ~signal_recovery_handlers()
+    {
+      if(!_enabled)
+        return;
+      std::lock_guard<std::mutex> g(_lock());
+      if(--_count() > 0)
+        return;
+      for(size_t n = 0; n < signal_recovery_signals_count; n++)
+        sigaction(signal_recovery_signals[n], &signal_recovery_previous()[n], nullptr);
+    }
+  };
+
+  // An alternate signal stack for the calling thread, so a permutation which overflowed
+  // its stack can still be recovered. Removed when the thread exits.
+  struct signal_recovery_stack
+  {
+    std::unique_ptr<char[]> stack;
+    size_t size{0};
+
+    signal_recovery_stack()
+    {
+      stack_t current;
+      if(sigaltstack(nullptr, &current) == 0 && (current.ss_flags & SS_DISABLE) == 0)
+        return;  // someone else already installed one
+      size = std::max<size_t>(SIGSTKSZ, 65536);
+      stack.reset(new char[size]);
+      stack_t ss;
+      memset(&ss, 0, sizeof(ss));
+      ss.ss_sp = stack.get();
+      ss.ss_size = size;
+      if(sigaltstack(&ss, nullptr) == -1)
+        stack.reset();
+    }
+    signal_recovery_stack(const signal_recovery_stack &) = delete;
+    signal_recovery_stack &operator=(const signal_recovery_stack &) = delete;
+    ~signal_recovery_stack()
+    {
+      if(!stack)
+        return;
+      stack_t ss;
+      memset(&ss, 0, sizeof(ss));
+      ss.ss_flags = SS_DISABLE;
+      sigaltstack(&ss, nullptr);
+    }
+  };
+
+  /* Makes point the recovery point of the calling thread for the lifetime of the instance,
+  so a recovered signal returns from the sigsetjmp() which filled point with the signal number.
+  */
+  class signal_recovery_scope
+  {
+    sigjmp_buf *_previous;
+
+  public:
+    explicit signal_recovery_scope(sigjmp_buf *point)
+        : _previous(signal_recovery_point())
+    {
+      static QUICKCPPLIB_THREAD_LOCAL signal_recovery_stack stack;
+      (void) stack;
+      signal_recovery_point() = point;
+    }
+    signal_recovery_scope(const signal_recovery_scope &) = delete;
+    signal_recovery_scope &operator=(const signal_recovery_scope &) = delete;
+    ~signal_recovery_scope() { signal_recovery_point() = _previous; }
+  };
+}  // namespace detail
+
+KERNELTEST_V1_NAMESPACE_END
+
+#endif
+
+#endif
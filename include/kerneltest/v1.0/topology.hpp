@@ -0,0 +1,395 @@
+/* CPU topology and worker placement
+(C) 2026 agent <agent@local>
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#include "config.hpp"
+
+#ifndef KERNELTEST_TOPOLOGY_HPP
+#define KERNELTEST_TOPOLOGY_HPP
+
+#include "command_line.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <sched.h>
+#include <sys/mman.h>
+#endif
+
+KERNELTEST_V1_NAMESPACE_BEGIN
+
+namespace detail
+{
+  // Parses a Linux cpu list such as "0-3,8,10-11", ignoring anything malformed
+  inline std::vector<unsigned> parse_cpu_list(const std::string &list)
+  {
+    std::vector<unsigned> ret;
+    size_t pos = 0;
+    while(pos < list.size())
+    {
+      size_t comma = list.find(',', pos);
+      if(comma == std::string::npos)
+        comma = list.size();
+      const std::string item = list.substr(pos, comma - pos);
+      pos = comma + 1;
+      char *end = nullptr;
+      const unsigned long first = strtoul(item.c_str(), &end, 10);
+      if(end == item.c_str())
+        continue;
+      unsigned long last = first;
+      if(*end == '-')
+        last = strtoul(end + 1, nullptr, 10);
+      for(unsigned long cpu = first; cpu <= last && cpu < 65536; cpu++)
+        ret.push_back(static_cast<unsigned>(cpu));
+    }
+    std::sort(ret.begin(), ret.end());
+    ret.erase(std::unique(ret.begin(), ret.end()), ret.end());
+    return ret;
+  }
+
+#ifdef __linux__
+  // The cpus the calling thread may run on, or empty if unknown
+  inline std::vector<unsigned> thread_affinity()
+  {
+    std::vector<unsigned> ret;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if(sched_getaffinity(0, sizeof(set), &set) < 0)
+      return ret;
+    for(unsigned cpu = 0; cpu < CPU_SETSIZE; cpu++)
+    {
+      if(CPU_ISSET(cpu, &set))
+        ret.push_back(cpu);
+    }
+    return ret;
+  }
+  // Restricts the calling thread to cpus, returning false if the system refused
+  inline bool set_thread_affinity(const std::vector<unsigned> &cpus)
+  {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for(unsigned cpu : cpus)
+    {
+      if(cpu < CPU_SETSIZE)
+        CPU_SET(cpu, &set);
+    }
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+  }
+#else
+  inline std::vector<unsigned> thread_affinity() { return {}; }
+  inline bool set_thread_affinity(const std::vector<unsigned> & /*unused*/) { return false; }
+#endif
+}  // namespace detail
+
+//! \brief A NUMA node, and the cpus in it which this process may run on
+struct numa_node
+{
+  unsigned id{0};               //!< The number of the node
+  std::vector<unsigned> cpus;  //!< The cpus of the node this process may run on, in ascending order
+};
+
+/*! \brief The NUMA nodes of the machine, as read from `/sys/devices/system/node` on Linux.
+
+Only cpus in the affinity mask of the process when first asked are included, so a process confined by
+a cpuset or `taskset` sees only what it may use. Machines without NUMA, and other platforms, have a
+single node zero containing every cpu.
+*/
+class cpu_topology
+{
+  std::vector<numa_node> _nodes;
+
+  cpu_topology()
+  {
+    std::vector<unsigned> allowed = detail::thread_affinity();
+    if(allowed.empty())
+    {
+      const unsigned count = std::max(1U, std::thread::hardware_concurrency());
+      for(unsigned cpu = 0; cpu < count; cpu++)
+        allowed.push_back(cpu);
+    }
+#ifdef __linux__
+    // Node numbers can be sparse, so probe a generous range
+    for(unsigned id = 0; id < 1024; id++)
+    {
+      std::ifstream s("/sys/devices/system/node/node" + std::to_string(id) + "/cpulist");
+      if(!s)
+        continue;
+      std::string list;
+      std::getline(s, list);
+      numa_node node;
+      node.id = id;
+      for(unsigned cpu : detail::parse_cpu_list(list))
+      {
+        if(std::binary_search(allowed.begin(), allowed.end(), cpu))
+          node.cpus.push_back(cpu);
+      }
+      if(!node.cpus.empty())
+        _nodes.push_back(std::move(node));
+    }
+#endif
+    if(_nodes.empty())
+    {
+      numa_node node;
+      node.cpus = std::move(allowed);
+      _nodes.push_back(std::move(node));
+    }
+  }
+
+public:
+  //! The topology of this machine, read once per process
+  static const cpu_topology &system()
+  {
+    static const cpu_topology v;
+    return v;
+  }
+
+  //! The nodes with cpus this process may run on
+  const std::vector<numa_node> &nodes() const noexcept { return _nodes; }
+  //! The node numbered `id`, or null if this process may not run on any of its cpus
+  const numa_node *node(unsigned id) const noexcept
+  {
+    for(const auto &i : _nodes)
+    {
+      if(i.id == id)
+        return &i;
+    }
+    return nullptr;
+  }
+};
+
+//! \brief How the workers of a multithreaded `parameter_permuter` are pinned to cpus
+enum class worker_placement
+{
+  none,   //!< Workers may run on any cpu allowed, and migrate freely
+  cores,  //!< Each worker is pinned to a cpu of its own, dealt round robin across the nodes
+  nodes   //!< Each worker is pinned to every cpu of a node, dealt round robin across the nodes
+};
+
+/*! \brief Where the workers of a multithreaded `parameter_permuter` may run.
+
+Pinning workers stops them migrating between sockets away from the memory they touched first, which
+both speeds up kernels touching large buffers and makes their timings less noisy. Restricting every
+worker to one node gives reproducible measurements on multi socket machines, and if
+`permuter_options::workers` is zero, the number of workers becomes the number of cpus used.
+*/
+struct worker_affinity
+{
+  //! How workers are pinned within the cpus used
+  worker_placement placement{worker_placement::none};
+  //! If not negative, only the cpus of this NUMA node are used
+  int node{-1};
+  //! If not empty, only these cpus are used
+  std::vector<unsigned> cpus;
+
+  //! True if workers are pinned or restricted at all
+  bool enabled() const noexcept { return placement != worker_placement::none || node >= 0 || !cpus.empty(); }
+
+  /*! Returns the affinity given by `--kerneltest-pin=cores|nodes`, `--kerneltest-numa-node=N` and
+  `--kerneltest-cpus=list` on the command line, or the `KERNELTEST_PIN`, `KERNELTEST_NUMA_NODE` and
+  `KERNELTEST_CPUS` environment variables, where list is like `0-3,8,10-11`.
+  */
+  static worker_affinity from_command_line()
+  {
+    worker_affinity ret;
+    auto pin = command_line_option("pin");
+    if(pin)
+    {
+      if(*pin == "cores" || pin->empty())
+        ret.placement = worker_placement::cores;
+      else if(*pin == "nodes")
+        ret.placement = worker_placement::nodes;
+      else if(*pin != "none")
+      {
+        KERNELTEST_CERR("WARNING: Ignoring unknown worker placement '" << *pin << "', expected cores, nodes or none" << std::endl);
+      }
+    }
+    auto node = command_line_option("numa-node");
+    if(node && !node->empty())
+      ret.node = atoi(node->c_str());
+    auto cpus = command_line_option("cpus");
+    if(cpus && !cpus->empty())
+      ret.cpus = detail::parse_cpu_list(*cpus);
+    return ret;
+  }
+
+  //! The nodes used, each with only the cpus used
+  std::vector<numa_node> nodes() const
+  {
+    std::vector<numa_node> ret;
+    for(const auto &i : cpu_topology::system().nodes())
+    {
+      if(node >= 0 && i.id != static_cast<unsigned>(node))
+        continue;
+      numa_node n;
+      n.id = i.id;
+      for(unsigned cpu : i.cpus)
+      {
+        if(cpus.empty() || std::find(cpus.begin(), cpus.end(), cpu) != cpus.end())
+          n.cpus.push_back(cpu);
+      }
+      if(!n.cpus.empty())
+        ret.push_back(std::move(n));
+    }
+    return ret;
+  }
+  //! The number of cpus used
+  size_t cpu_count() const
+  {
+    size_t ret = 0;
+    for(const auto &i : nodes())
+      ret += i.cpus.size();
+    return ret;
+  }
+  //! The cpus the worker numbered `worker` is pinned to. Empty if no cpus are usable.
+  std::vector<unsigned> cpus_of_worker(size_t worker) const
+  {
+    const std::vector<numa_node> used = nodes();
+    if(used.empty())
+      return {};
+    if(placement == worker_placement::nodes)
+      return used[worker % used.size()].cpus;
+    if(placement == worker_placement::cores)
+    {
+      // Deal the cpus of the nodes alternately, so consecutive workers land on different nodes
+      size_t total = 0;
+      for(const auto &i : used)
+        total += i.cpus.size();
+      std::vector<unsigned> order;
+      for(size_t n = 0; order.size() < total; n++)
+      {
+        for(const auto &i : used)
+        {
+          if(n < i.cpus.size())
+            order.push_back(i.cpus[n]);
+        }
+      }
+      return {order[worker % order.size()]};
+    }
+    std::vector<unsigned> ret;
+    for(const auto &i : used)
+      ret.insert(ret.end(), i.cpus.begin(), i.cpus.end());
+    return ret;
+  }
+};
+
+namespace detail
+{
+  /* Pins the calling thread as worker number `worker` of some affinity, restoring its previous
+  affinity on destruction, so the calling thread of a permuter is left as it was found.
+  */
+  class worker_affinity_scope
+  {
+    std::vector<unsigned> _previous;
+    bool _pinned{false};
+
+  public:
+    worker_affinity_scope(const worker_affinity *affinity, size_t worker)
+    {
+      if(affinity == nullptr || !affinity->enabled())
+        return;
+      const std::vector<unsigned> cpus = affinity->cpus_of_worker(worker);
+      if(cpus.empty())
+      {
+        KERNELTEST_CERR("WARNING: No cpus this process may use match the worker affinity, so workers are not pinned" << std::endl);
+        return;
+      }
+      _previous = thread_affinity();
+      _pinned = set_thread_affinity(cpus);
+      if(!_pinned)
+      {
+        KERNELTEST_CERR("WARNING: Couldn't pin worker " << worker << " to its cpus" << std::endl);
+      }
+    }
+    worker_affinity_scope(const worker_affinity_scope &) = delete;
+    worker_affinity_scope &operator=(const worker_affinity_scope &) = delete;
+    ~worker_affinity_scope()
+    {
+      if(_pinned && !_previous.empty())
+        set_thread_affinity(_previous);
+    }
+  };
+
+  struct worker_scratch_storage
+  {
+    void *p{nullptr};
+    size_t size{0};
+    worker_scratch_storage() = default;
+    worker_scratch_storage(const worker_scratch_storage &) = delete;
+    worker_scratch_storage &operator=(const worker_scratch_storage &) = delete;
+    ~worker_scratch_storage() { release(); }
+    void release() noexcept
+    {
+      if(p == nullptr)
+        return;
+#ifdef __linux__
+      munmap(p, size);
+#else
+      free(p);
+#endif
+      p = nullptr;
+      size = 0;
+    }
+  };
+}  // namespace detail
+
+/*! \brief Returns at least `bytes` of scratch memory private to the calling thread, valid until the next call
+on that thread or until it exits.
+
+The memory is allocated fresh by the calling thread and every page of it is written by that thread, so with
+the default first touch policy of Linux it lives on the NUMA node the thread is running on. Call this from a
+pinned worker, for example from a kernel or a hook, to get memory local to that worker. Its contents are unspecified.
+*/
+inline void *worker_scratch(size_t bytes)
+{
+  static thread_local detail::worker_scratch_storage storage;
+  if(bytes <= storage.size)
+    return storage.p;
+  storage.release();
+#ifdef __linux__
+  void *p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if(p == MAP_FAILED)
+    throw std::bad_alloc();
+  // Touch every page from this thread, so each is placed on this thread's node
+  const size_t page = 4096;
+  for(size_t n = 0; n < bytes; n += page)
+    static_cast<volatile char *>(p)[n] = 0;
+#else
+  void *p = malloc(bytes);
+  if(p == nullptr)
+    throw std::bad_alloc();
+#endif
+  storage.p = p;
+  storage.size = bytes;
+  return p;
+}
+
+KERNELTEST_V1_NAMESPACE_END
+
+#endif
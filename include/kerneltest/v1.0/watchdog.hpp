@@ -0,0 +1,232 @@
+/* Timeouts for permutations executed in process
+(C) 2026 agent <agent@local>
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#include "config.hpp"
+
+#ifndef KERNELTEST_WATCHDOG_HPP
+#define KERNELTEST_WATCHDOG_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+KERNELTEST_V1_NAMESPACE_BEGIN
+
+namespace detail
+{
+  //! The timed out error code for a permutation which was in stage when it ran out of time
+  inline kerneltest_errc timed_out_code(int stage) noexcept
+  {
+    if(1 == stage)
+      return kerneltest_errc::kernel_timed_out;
+    if(2 == stage)
+      return kerneltest_errc::teardown_timed_out;
+    return kerneltest_errc::setup_timed_out;
+  }
+
+  /* A thread which flags the permutations still executing past their deadline, reporting each as
+  it becomes overdue so a hang is visible in the log while it is happening. A permutation timed
+  out if and only if the watchdog flagged it before it finished.
+  */
+  class permutation_watchdog
+  {
+  public:
+    //! A permutation being watched, which lives on the stack of the thread executing it
+    struct entry
+    {
+      size_t idx;
+      std::chrono::milliseconds timeout;
+      std::chrono::steady_clock::time_point deadline;
+      const volatile int *stage;
+      int overdue_stage{-1};  // the stage it was in when flagged, if flagged
+
+      entry(size_t _idx, std::chrono::milliseconds _timeout, const volatile int *_stage)
+          : idx(_idx)
+          , timeout(_timeout)
+          , deadline(std::chrono::steady_clock::now() + _timeout)
+          , stage(_stage)
+      {
+      }
+    };
+
+  private:
+    std::mutex _lock;
+    std::condition_variable _changed;
+    std::vector<entry *> _entries;
+    std::chrono::steady_clock::time_point _wake{std::chrono::steady_clock::time_point::max()};
+    bool _stop{false};
+    std::thread _thread;
+
+    void _run()
+    {
+      std::unique_lock<std::mutex> g(_lock);
+      while(!_stop)
+      {
+        const auto now = std::chrono::steady_clock::now();
+        _wake = std::chrono::steady_clock::time_point::max();
+        for(entry *e : _entries)
+        {
+          if(e->overdue_stage >= 0)
+            continue;
+          if(e->deadline <= now)
+          {
+            e->overdue_stage = *e->stage;
+            KERNELTEST_CERR("WARNING: Permutation " << e->idx << " has exceeded its timeout of " << e->timeout.count() << " ms" << std::endl);
+          }
+          else
+            _wake = std::min(_wake, e->deadline);
+        }
+        if(_wake == std::chrono::steady_clock::time_point::max())
+          _changed.wait(g);
+        else
+          _changed.wait_until(g, _wake);
+      }
+    }
+
+  public:
+    permutation_watchdog()
+        : _thread([this] { _run(); })
+    {
+    }
+    permutation_watchdog(const permutation_watchdog &) = delete;
+    permutation_watchdog &operator=(const permutation_watchdog &) = delete;
+    ~permutation_watchdog()
+    {
+      {
+        std::lock_guard<std::mutex> g(_lock);
+        _stop = true;
+      }
+      _changed.notify_one();
+      _thread.join();
+    }
+
+    //! Starts watching e
+    void add(entry &e)
+    {
+      std::lock_guard<std::mutex> g(_lock);
+      _entries.push_back(&e);
+      // Only wake the watchdog if it would otherwise sleep past this deadline
+      if(e.deadline < _wake)
+      {
+        _wake = e.deadline;
+        _changed.notify_one();
+      }
+    }
+    //! Stops watching e, returning true if it was flagged as overdue
+    bool remove(entry &e)
+    {
+      std::lock_guard<std::mutex> g(_lock);
+      auto it = std::find(_entries.begin(), _entries.end(), &e);
+      if(it != _entries.end())
+      {
+        *it = _entries.back();
+        _entries.pop_back();
+      }
+      return e.overdue_stage >= 0;
+    }
+  };
+
+  /* Executes jobs on a thread of its own, so the thread dispatching them can stop waiting for one
+  which overruns its deadline. The thread executing that job is then abandoned to finish it, or
+  not, by itself, and a new thread is started for the next job.
+  */
+  class abandonable_runner
+  {
+    struct state
+    {
+      std::mutex lock;
+      std::condition_variable changed;
+      std::function<void()> job;
+      bool busy{false}, stop{false};
+    };
+    std::shared_ptr<state> _state;
+    std::thread _thread;
+
+    static void _run(std::shared_ptr<state> s)
+    {
+      std::unique_lock<std::mutex> g(s->lock);
+      for(;;)
+      {
+        s->changed.wait(g, [&] { return s->busy || s->stop; });
+        if(!s->busy)
+          return;
+        g.unlock();
+        s->job();
+        g.lock();
+        s->job = nullptr;
+        s->busy = false;
+        s->changed.notify_all();
+        // If abandoned, the dispatcher has long gone
+        if(s->stop)
+          return;
+      }
+    }
+
+  public:
+    abandonable_runner() = default;
+    abandonable_runner(const abandonable_runner &) = delete;
+    abandonable_runner &operator=(const abandonable_runner &) = delete;
+    ~abandonable_runner()
+    {
+      if(!_state)
+        return;
+      {
+        std::lock_guard<std::mutex> g(_state->lock);
+        _state->stop = true;
+      }
+      _state->changed.notify_all();
+      _thread.join();
+    }
+
+    //! Executes job, returning false if deadline passed first, in which case job was abandoned still executing
+    bool run(std::function<void()> job, std::chrono::steady_clock::time_point deadline)
+    {
+      if(!_state)
+      {
+        _state = std::make_shared<state>();
+        _thread = std::thread(_run, _state);
+      }
+      std::unique_lock<std::mutex> g(_state->lock);
+      _state->job = std::move(job);
+      _state->busy = true;
+      _state->changed.notify_all();
+      if(_state->changed.wait_until(g, deadline, [&] { return !_state->busy; }))
+        return true;
+      _state->stop = true;
+      g.unlock();
+      _thread.detach();
+      _state.reset();
+      return false;
+    }
+  };
+}  // namespace detail
+
+KERNELTEST_V1_NAMESPACE_END
+
+#endif
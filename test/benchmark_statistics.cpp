@@ -0,0 +1,87 @@
+/* Tests that benchmarking fills in the latency statistics of permutations which pass, fails those which
+throw when repeated, and stops repeating once the time allowed has passed including the setting up of hooks
+*/
+
+#include "kerneltest/kerneltest.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+using namespace KERNELTEST_V1_NAMESPACE;
+
+static int calls;
+
+// Sums a to b, throwing something not derived from std::exception on the third call if asked to
+static result<int> sum(int a, int b, int throw_on_third)
+{
+  if(throw_on_third != 0 && ++calls == 3)
+    throw 5;
+  volatile int total = 0;
+  for(int n = a; n < b; n++)
+    total = total + n;
+  return total;
+}
+
+int main()
+{
+  current_test_kernel.category = "unit";
+  current_test_kernel.product = "kerneltest";
+  current_test_kernel.test = "benchmark_statistics";
+  current_test_kernel.name = "sum";
+  bool ok = true;
+  {
+    static const parameters<result<int>, parameters<int, int, int>> table[] = {
+      {45, {0, 10, 0}}, {4950, {0, 100, 0}}, {make_error_code(std::errc::invalid_argument), {0, 10, 0}}, {45, {0, 10, 1}},
+    };
+    auto permuter(st_permute_parameters(table));
+    benchmark_options options;
+    options.min_repetitions = 20;
+    options.max_repetitions = 100;
+    auto results = permuter.benchmark(sum, options);
+    permuter.check(results, pretty_print_failure(permuter), pretty_print_success(permuter));
+    for(size_t idx = 0; idx < 2; idx++)
+    {
+      const latency_statistics &v = results[idx]->latency;
+      if(!results[idx]->passed() || v.samples < options.min_repetitions || v.samples > options.max_repetitions || v.min > v.median || v.median > v.p99 || v.p99 > v.max || v.mean < static_cast<double>(v.min) || v.mean > static_cast<double>(v.max))
+      {
+        std::printf("permutation %zu has unexpected statistics\n", idx);
+        ok = false;
+      }
+    }
+    // The permutation not producing its expected outcome is not timed
+    if(results[2]->passed() || results[2]->latency.samples != 0)
+    {
+      std::printf("permutation 2 should have failed untimed\n");
+      ok = false;
+    }
+    // The permutation throwing when repeated fails as if it had thrown the first time
+    if(results[3]->passed() || results[3]->latency.samples != 0 || results[3]->outcome.error_code() != make_error_code(kerneltest_errc::kernel_exception_thrown))
+    {
+      std::printf("permutation 3 should have failed with kernel_exception_thrown\n");
+      ok = false;
+    }
+  }
+  {
+    // Setting up the hook takes far longer than the kernel
+    static const parameters<result<int>, parameters<int, int, int>, hooks::custom_parameters<int>> table[] = {
+      {45, {0, 10, 0}, {0}},
+    };
+    auto permuter(st_permute_parameters(table, hooks::custom([](auto &, auto &, size_t, int) { std::this_thread::sleep_for(std::chrono::milliseconds(10)); return 0; }, [](int) {}, "slow setup")));
+    benchmark_options options;
+    options.min_repetitions = 2;
+    options.max_repetitions = 1000000;
+    options.confidence = 0;
+    options.max_time = std::chrono::milliseconds(200);
+    auto begin = std::chrono::steady_clock::now();
+    auto results = permuter.benchmark(sum, options);
+    auto took = std::chrono::steady_clock::now() - begin;
+    if(!results[0]->passed() || took > std::chrono::seconds(2))
+    {
+      std::printf("benchmarking with a slow hook took %lld ms\n", static_cast<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(took).count()));
+      ok = false;
+    }
+  }
+  std::printf("%s\n", ok ? "PASSED" : "FAILED");
+  return ok ? 0 : 1;
+}
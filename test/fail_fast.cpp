@@ -0,0 +1,66 @@
+/* Tests that failing fast stops executing permutations after the first one not producing its expected
+outcome, leaving the rest reported as not run
+*/
+
+#include "kerneltest/kerneltest.hpp"
+
+#include <cstdio>
+
+using namespace KERNELTEST_V1_NAMESPACE;
+
+static result<int> divide(int a, int b)
+{
+  return a / b;
+}
+
+int main()
+{
+  current_test_kernel.category = "unit";
+  current_test_kernel.product = "kerneltest";
+  current_test_kernel.test = "fail_fast";
+  current_test_kernel.name = "divide";
+  // The third permutation fails
+  static const parameters<result<int>, parameters<int, int>> table[] = {
+    {5, {10, 2}}, {100, {2000, 20}}, {4, {9, 3}}, {2, {4, 2}}, {7, {7, 1}}, {3, {9, 3}},
+  };
+  bool ok = true;
+  // Returns true if the first three permutations ran and the rest were reported as not run
+  auto check = [&](const auto &permuter, const auto &results) {
+    size_t ran = 0, not_run = 0;
+    auto counted = [&](size_t, const auto &, const auto &) {
+      ++ran;
+      return true;
+    };
+    auto not_run_f = [&](size_t idx, const auto &) {
+      if(idx >= 3)
+        ++not_run;
+      return true;
+    };
+    permuter.check(results, counted, counted, not_run_f);
+    if(ran != 3 || not_run != 3)
+    {
+      std::printf("%zu permutations ran and %zu after the failure were not run\n", ran, not_run);
+      ok = false;
+    }
+  };
+  // A single worker claiming one permutation at a time executes them in order
+  auto st(st_permute_parameters(table));
+  st.options().fail_fast = true;
+  auto mt(mt_permute_parameters(table));
+  mt.options().fail_fast = true;
+  mt.options().workers = 1;
+  mt.options().chunk = 1;
+  check(st, st(divide));
+  check(mt, mt(divide));
+#ifndef _WIN32
+  check(st, st.isolated(divide));
+#endif
+  const check_summary summary(st.run_and_check(divide, [](size_t, const auto &, const auto &) { return false; }));
+  if(summary.ran_count() != 3 || summary.passed_count() != 2 || summary.failed_count() != 1)
+  {
+    std::printf("run_and_check() ran %zu permutations of which %zu passed\n", summary.ran_count(), summary.passed_count());
+    ok = false;
+  }
+  std::printf("%s\n", ok ? "PASSED" : "FAILED");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,85 @@
+/* Tests that the heap accounting hook fails permutations which leak or exceed their allocation budget,
+and that the performance counters hook doesn't allocate where the heap accounting hook would see it
+*/
+
+#define KERNELTEST_REPLACE_OPERATOR_NEW
+#include "kerneltest/kerneltest.hpp"
+
+#include <cstdio>
+
+using namespace KERNELTEST_V1_NAMESPACE;
+
+static result<int> divide(int a, int b)
+{
+  return a / b;
+}
+
+// Blocks leaked by allocate(), freed once the permutations have been checked
+static char *leaked_blocks[8];
+static size_t leaked_count;
+
+// Allocates count blocks of 64 bytes, leaking the first leak of them
+static result<int> allocate(int count, int leak)
+{
+  for(int n = 0; n < count; n++)
+  {
+    char *p = new char[64];
+    if(n < leak)
+      leaked_blocks[leaked_count++] = p;
+    else
+      delete[] p;
+  }
+  return count;
+}
+
+// Returns true if the heap usage of the permutation at idx is as expected
+template <class Permuter> static bool check_usage(const Permuter &permuter, size_t idx, uint64_t allocations, uint64_t peak_bytes, uint64_t leaked, size_t budget)
+{
+  hooks::heap_usage usage;
+  if(!permuter.heap_usage(idx, usage))
+  {
+    std::printf("permutation %zu has no heap usage\n", idx);
+    return false;
+  }
+  if(usage.allocations != allocations || usage.bytes != allocations * 64 || usage.peak_bytes != peak_bytes || usage.leaked != leaked || usage.leaked_bytes != leaked * 64 || usage.budget != budget)
+  {
+    std::printf("permutation %zu has unexpected heap usage %s\n", idx, hooks::print(usage).c_str());
+    return false;
+  }
+  return true;
+}
+
+int main()
+{
+  current_test_kernel.category = "unit";
+  current_test_kernel.product = "kerneltest";
+  current_test_kernel.test = "heap_accounting_performance_counters";
+  current_test_kernel.name = "divide";
+  // The kernel never allocates, so every row passes unless something else is accounted for
+  static const parameters<result<int>, parameters<int, int>, hooks::heap_accounting_parameters, hooks::performance_counters_parameters> table[] = {
+    {5, {10, 2}, {0}, {}}, {100, {2000, 20}, {0}, {}}, {3, {9, 3}, {0}, {}}, {0, {0, 5}, {0}, {}},
+  };
+  auto permuter(mt_permute_parameters(table, hooks::heap_accounting(), hooks::performance_counters()));
+  auto results = permuter(divide);
+  bool ok = permuter.check(results, pretty_print_failure(permuter), pretty_print_success(permuter));
+  results = permuter(divide);
+  if(!permuter.check(results, pretty_print_failure(permuter)))
+    ok = false;
+
+  // Rows allocating within their budget, leaking, and allocating more times than their budget allows
+  static const parameters<result<int>, parameters<int, int>, hooks::heap_accounting_parameters, hooks::performance_counters_parameters> allocating[] = {
+    {3, {3, 0}, {3}, {}},
+    {make_error_code(kerneltest_errc::allocations_leaked), {2, 1}, {5}, {}},
+    {make_error_code(kerneltest_errc::allocation_budget_exceeded), {4, 0}, {2}, {}},
+  };
+  auto allocating_permuter(mt_permute_parameters(allocating, hooks::heap_accounting(), hooks::performance_counters()));
+  auto allocating_results = allocating_permuter(allocate);
+  if(!allocating_permuter.check(allocating_results, pretty_print_failure(allocating_permuter), pretty_print_success(allocating_permuter)))
+    ok = false;
+  if(!check_usage(allocating_permuter, 0, 3, 64, 0, 3) || !check_usage(allocating_permuter, 1, 2, 128, 1, 5) || !check_usage(allocating_permuter, 2, 4, 64, 0, 2))
+    ok = false;
+  while(leaked_count > 0)
+    delete[] leaked_blocks[--leaked_count];
+  std::printf("%s\n", ok ? "PASSED" : "FAILED");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,73 @@
+/* Tests that a hook with a session makes one session per worker for each execution of the parameter
+sequence rather than one per permutation, and that the session is what sets up every permutation
+*/
+
+#include "kerneltest/kerneltest.hpp"
+
+#include <atomic>
+#include <cstdio>
+
+using namespace KERNELTEST_V1_NAMESPACE;
+
+static std::atomic<int> sessions(0), session_uses(0), hook_uses(0);
+
+// A hook counting the sessions made and the permutations set up by them and by itself
+struct counting_hook
+{
+  struct session_type
+  {
+    template <class Parent, class RetType> int operator()(Parent * /*unused*/, RetType & /*unused*/, size_t /*unused*/, int /*unused*/)
+    {
+      ++session_uses;
+      return 0;
+    }
+  };
+  template <class Parent, class RetType> int operator()(Parent * /*unused*/, RetType & /*unused*/, size_t /*unused*/, int /*unused*/) const
+  {
+    ++hook_uses;
+    return 0;
+  }
+  session_type session() const
+  {
+    ++sessions;
+    return {};
+  }
+  std::string print(int /*unused*/) const { return "counting"; }
+};
+
+static result<int> divide(int a, int b)
+{
+  return a / b;
+}
+
+int main()
+{
+  current_test_kernel.category = "unit";
+  current_test_kernel.product = "kerneltest";
+  current_test_kernel.test = "hook_sessions";
+  current_test_kernel.name = "divide";
+  auto seq = generate_parameters(200, [](size_t idx) { return parameters<result<int>, parameters<int, int>, parameters<int>>(static_cast<int>(idx), {static_cast<int>(idx) * 2, 2}, {0}); });
+  bool ok = true;
+  // Returns true if at most most_sessions sessions set up all 200 permutations
+  auto counted = [&](const char *what, int most_sessions) {
+    const bool ret = sessions > 0 && sessions <= most_sessions && session_uses == 200 && hook_uses == 0;
+    if(!ret)
+      std::printf("%s made %d sessions setting up %d permutations, and the hook set up %d\n", what, sessions.load(), session_uses.load(), hook_uses.load());
+    sessions = session_uses = hook_uses = 0;
+    return ret;
+  };
+  auto st(st_permute_parameters(seq, counting_hook()));
+  ok = st.check(st(divide), pretty_print_failure(st)) && ok;
+  ok = counted("single threaded call", 1) && ok;
+  auto mt(mt_permute_parameters(seq, counting_hook()));
+  mt.options().workers = 2;
+  mt.options().chunk = 1;
+  ok = mt.check(mt(divide), pretty_print_failure(mt)) && ok;
+  ok = counted("multithreaded call", 2) && ok;
+  ok = mt.run_and_check(divide, pretty_print_failure(mt)).all_passed() && ok;
+  ok = counted("run_and_check()", 2) && ok;
+  ok = mt.stream(divide, [](size_t, const auto &result, const auto &shouldbe) { return result && *result == shouldbe; }) && ok;
+  ok = counted("stream()", 2) && ok;
+  std::printf("%s\n", ok ? "PASSED" : "FAILED");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,57 @@
+/* Tests that a permutation crashing its worker process under isolated() is recorded as failed, and that
+the worker is replaced so the permutations after it still execute
+*/
+
+#include "kerneltest/kerneltest.hpp"
+
+#include <cstdio>
+
+using namespace KERNELTEST_V1_NAMESPACE;
+
+static result<int> divide(int a, int b)
+{
+  if(a < 0)
+  {
+    volatile int *p = nullptr;
+    *p = 1;
+  }
+  return a / b;
+}
+
+int main()
+{
+#ifdef _WIN32
+  std::printf("PASSED\n");
+  return 0;
+#else
+  current_test_kernel.category = "unit";
+  current_test_kernel.product = "kerneltest";
+  current_test_kernel.test = "isolated_crash";
+  current_test_kernel.name = "divide";
+  static const parameters<result<int>, parameters<int, int>> table[] = {
+    {5, {10, 2}}, {make_error_code(kerneltest_errc::kernel_signal_thrown), {-1, 3}}, {3, {9, 3}}, {1, {-2, 1}}, {2, {4, 2}},
+  };
+  bool ok = true;
+  auto check = [&](const auto &results) {
+    for(size_t idx = 0; idx < results.size(); idx++)
+    {
+      // The permutation expecting the crash passes, the one not expecting it fails
+      const auto &v = results[idx];
+      if(!v || v->passed() != (idx != 3) || (idx == 3 && v->error_code() != make_error_code(kerneltest_errc::kernel_signal_thrown)))
+      {
+        std::printf("permutation %zu has an unexpected outcome\n", idx);
+        ok = false;
+      }
+    }
+  };
+  auto st(st_permute_parameters(table));
+  check(st.isolated(divide));
+  // A single worker executing every permutation must be replaced after each crash for the last to execute
+  auto mt(mt_permute_parameters(table));
+  mt.options().workers = 1;
+  mt.options().chunk = 5;
+  check(mt.isolated(divide));
+  std::printf("%s\n", ok ? "PASSED" : "FAILED");
+  return ok ? 0 : 1;
+#endif
+}
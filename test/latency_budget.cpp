@@ -0,0 +1,69 @@
+/* Tests that a permutation producing its expected outcome but taking longer than its latency budget every
+time it is measured fails with kerneltest_errc::latency_budget_exceeded, and that how long it took is recorded
+*/
+
+#include "kerneltest/kerneltest.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+using namespace KERNELTEST_V1_NAMESPACE;
+using namespace std::chrono_literals;
+
+static int slow_calls;
+
+// Sleeps for a milliseconds
+static result<int> divide(int a, int b)
+{
+  if(a > 0)
+  {
+    ++slow_calls;
+    std::this_thread::sleep_for(std::chrono::milliseconds(a));
+  }
+  return a / b;
+}
+
+int main()
+{
+  current_test_kernel.category = "unit";
+  current_test_kernel.product = "kerneltest";
+  current_test_kernel.test = "latency_budget";
+  current_test_kernel.name = "divide";
+  // A fast permutation within its budget, a slow one over it, and a slow one without a budget
+  static const parameters<result<int>, parameters<int, int>, hooks::latency_budget_parameters> table[] = {
+    {0, {0, 1}, {1s}}, {10, {20, 2}, {1ms}}, {10, {20, 2}, {0ns}},
+  };
+  auto permuter(st_permute_parameters(table, hooks::latency_budget(2)));
+  auto results = permuter(divide);
+  permuter.check(results, pretty_print_failure(permuter), pretty_print_success(permuter));
+  bool ok = true;
+  for(size_t idx = 0; idx < results.size(); idx++)
+  {
+    const bool overran = results[idx] && results[idx]->has_error() && results[idx]->error() == make_error_code(kerneltest_errc::latency_budget_exceeded);
+    if(overran != (idx == 1))
+    {
+      std::printf("permutation %zu %s its latency budget\n", idx, overran ? "exceeded" : "did not exceed");
+      ok = false;
+    }
+  }
+  // The slow permutation over its budget is measured twice more before failing
+  if(slow_calls != 4)
+  {
+    std::printf("the slow permutations were called %d times\n", slow_calls);
+    ok = false;
+  }
+  hooks::latency_budget_overrun overrun;
+  if(!permuter.latency_budget_overran(1, overrun) || overrun.took < 20ms || overrun.budget != 1ms)
+  {
+    std::printf("the overrun of the slow permutation was not recorded\n");
+    ok = false;
+  }
+  if(permuter.latency_budget_overran(0, overrun) || permuter.latency_budget_overran(2, overrun))
+  {
+    std::printf("an overrun was recorded for a permutation within its budget\n");
+    ok = false;
+  }
+  std::printf("%s\n", ok ? "PASSED" : "FAILED");
+  return ok ? 0 : 1;
+}
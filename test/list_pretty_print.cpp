@@ -0,0 +1,58 @@
+/* Tests that pretty printing the outcomes of a long parameter sequence without random access
+takes time in proportion to its length, rather than walking the sequence to every permutation
+*/
+
+#include "kerneltest/kerneltest.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <list>
+#include <sstream>
+
+using namespace KERNELTEST_V1_NAMESPACE;
+
+static result<int> divide(int a, int b)
+{
+  return a / b;
+}
+
+using row_type = parameters<result<int>, parameters<int, int>, hooks::custom_parameters<int>>;
+
+// Returns the fewest seconds taken to check and pretty print every outcome of a list of count rows,
+// half of which fail
+static double time_check(size_t count)
+{
+  std::list<row_type> rows;
+  for(size_t n = 0; n < count; n++)
+    rows.push_back(row_type(static_cast<int>(n % 2), {static_cast<int>(n), static_cast<int>(n) + 1}, {0}));
+  auto hook = hooks::custom([](auto &, auto &, size_t, int) { return 0; }, [](int) {}, "custom");
+  parameter_permuter<false, std::list<row_type>, decltype(hook)> permuter(std::move(rows), std::tuple<decltype(hook)>(std::move(hook)));
+  auto results = permuter(divide);
+  std::ostringstream sink;
+  double fewest = 1e9;
+  for(int attempt = 0; attempt < 3; attempt++)
+  {
+    sink.str(std::string());
+    detail::pretty_print_capture_scope capture(sink);
+    auto begin = std::chrono::steady_clock::now();
+    permuter.check(results, pretty_print_failure(permuter), pretty_print_success(permuter));
+    permuter.run_and_check(divide, pretty_print_failure(permuter));
+    fewest = std::min(fewest, std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count());
+  }
+  return fewest;
+}
+
+int main()
+{
+  current_test_kernel.category = "unit";
+  current_test_kernel.product = "kerneltest";
+  current_test_kernel.test = "list_pretty_print";
+  current_test_kernel.name = "divide";
+  // Four times the permutations should take about four times as long, not sixteen
+  const double small = time_check(5000), large = time_check(20000);
+  const bool ok = large < small * 10;
+  std::printf("%zu permutations took %f secs, %zu took %f secs\n", size_t(5000), small, size_t(20000), large);
+  std::printf("%s\n", ok ? "PASSED" : "FAILED");
+  return ok ? 0 : 1;
+}
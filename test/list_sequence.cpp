@@ -0,0 +1,41 @@
+/* Tests that a parameter sequence without random access can be permuted with hooks
+*/
+
+#include "kerneltest/kerneltest.hpp"
+
+#include <cstdio>
+#include <list>
+
+using namespace KERNELTEST_V1_NAMESPACE;
+
+static result<int> divide(int a, int b)
+{
+  return a / b;
+}
+
+int main()
+{
+  current_test_kernel.category = "unit";
+  current_test_kernel.product = "kerneltest";
+  current_test_kernel.test = "list_sequence";
+  current_test_kernel.name = "divide";
+  using row_type = parameters<result<int>, parameters<int, int>, hooks::custom_parameters<int>>;
+  std::list<row_type> rows{{5, {10, 2}, {1}}, {100, {2000, 20}, {2}}, {3, {9, 3}, {3}}};
+  auto hook = hooks::custom([](auto &, auto &, size_t, int) { return 0; }, [](int) {}, "custom");
+  parameter_permuter<true, std::list<row_type>, decltype(hook)> permuter(std::move(rows), std::tuple<decltype(hook)>(std::move(hook)));
+  bool ok = true;
+  auto results = permuter(divide);
+  if(!permuter.check(results, pretty_print_failure(permuter), pretty_print_success(permuter)))
+    ok = false;
+  if(!permuter.parallel_check(results, pretty_print_failure(permuter)))
+    ok = false;
+  if(!permuter.stream(divide, [](size_t, const auto &result, const auto &shouldbe) { return result && *result == shouldbe; }))
+    ok = false;
+  if(!permuter.run_and_check(divide, pretty_print_failure(permuter)).all_passed())
+    ok = false;
+  auto recorded = permuter.isolated(divide);
+  if(!permuter.check(recorded, pretty_print_failure(permuter)))
+    ok = false;
+  std::printf("%s\n", ok ? "PASSED" : "FAILED");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,68 @@
+/* Tests that the output of permutations executed by a multithreaded permuter is captured per permutation,
+kept only for those which fail, and printed with them in order of index
+*/
+
+#include "kerneltest/kerneltest.hpp"
+
+#include <cstdio>
+#include <sstream>
+
+using namespace KERNELTEST_V1_NAMESPACE;
+
+// Says which permutation it is, then fails the fourth and eighth
+static result<int> say(int a)
+{
+  KERNELTEST_COUT("kernel " << a << " says hi" << std::endl);
+  return (a == 3 || a == 7) ? -a : a;
+}
+
+int main()
+{
+  current_test_kernel.category = "unit";
+  current_test_kernel.product = "kerneltest";
+  current_test_kernel.test = "log_capture";
+  current_test_kernel.name = "say";
+  auto permuter(mt_permute_parameters(generate_parameters(10, [](size_t idx) { return parameters<result<int>, parameters<int>>(static_cast<int>(idx), {static_cast<int>(idx)}); })));
+  permuter.options().workers = 2;
+  permuter.options().chunk = 1;
+  permuter.options().capture_log = log_capture_mode::failures;
+  auto results = permuter(say);
+  bool ok = true;
+  for(size_t idx = 0; idx < results.size(); idx++)
+  {
+    std::string log;
+    const bool kept = permuter.captured_log(idx, log);
+    const bool fails = (idx == 3 || idx == 7);
+    if(kept != fails || (kept && log != "kernel " + std::to_string(idx) + " says hi\n"))
+    {
+      std::printf("permutation %zu kept '%s'\n", idx, log.c_str());
+      ok = false;
+    }
+  }
+  std::ostringstream printed;
+  {
+    detail::pretty_print_capture_scope capture(printed);
+    permuter.check(results, pretty_print_failure(permuter));
+  }
+  const std::string s(printed.str());
+  const size_t third = s.find("| kernel 3 says hi"), seventh = s.find("| kernel 7 says hi");
+  if(third == std::string::npos || seventh == std::string::npos || seventh < third || s.find("kernel 5") != std::string::npos)
+  {
+    std::printf("check() printed:\n%s", s.c_str());
+    ok = false;
+  }
+  // Kept for every permutation if asked
+  permuter.options().capture_log = log_capture_mode::always;
+  results = permuter(say);
+  for(size_t idx = 0; idx < results.size(); idx++)
+  {
+    std::string log;
+    if(!permuter.captured_log(idx, log))
+    {
+      std::printf("permutation %zu kept nothing\n", idx);
+      ok = false;
+    }
+  }
+  std::printf("%s\n", ok ? "PASSED" : "FAILED");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,32 @@
+/* Tests that parameter sets hash the same whatever the addresses of what they point to
+*/
+
+#include "kerneltest/kerneltest.hpp"
+
+#include <cstdio>
+#include <memory>
+
+using namespace KERNELTEST_V1_NAMESPACE;
+
+int main()
+{
+  bool ok = true;
+  char ws1[] = "ws1", other_ws1[] = "ws1", ws2[] = "ws2";
+  int x = 1, y = 2;
+  // C strings are hashed by contents
+  parameters<result<int>, parameters<int, const char *>, parameters<char *>> a{0, {1, ws1}, {ws1}}, b{0, {1, other_ws1}, {other_ws1}}, c{0, {1, ws2}, {ws2}};
+  if(hash_parameter_set(a) != hash_parameter_set(b) || hash_parameter_set(a) == hash_parameter_set(c))
+  {
+    std::printf("FAILED: C strings were not hashed by their contents\n");
+    ok = false;
+  }
+  // Other pointers are left out, values are not
+  parameters<result<int>, parameters<int *, std::shared_ptr<int>, int>> d{0, {&x, std::make_shared<int>(1), 5}}, e{0, {&y, std::make_shared<int>(2), 5}}, f{0, {&x, nullptr, 6}};
+  if(hash_parameter_set(d) != hash_parameter_set(e) || hash_parameter_set(d) == hash_parameter_set(f))
+  {
+    std::printf("FAILED: pointers were hashed by address\n");
+    ok = false;
+  }
+  std::printf("%s\n", ok ? "PASSED" : "FAILED");
+  return ok ? 0 : 1;
+}
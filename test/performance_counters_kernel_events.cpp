@@ -0,0 +1,51 @@
+/* Tests that the performance counters hook counts the page faults and context switches of a kernel,
+which happen in the operating system kernel rather than in the test kernel
+*/
+
+#include "kerneltest/kerneltest.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+using namespace KERNELTEST_V1_NAMESPACE;
+
+// Sleeps, which switches context, and touches memory never touched before, which faults it in
+static result<size_t> sleep_and_touch(size_t bytes)
+{
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  std::vector<char> memory(bytes, 1);
+  return memory.size();
+}
+
+int main()
+{
+  current_test_kernel.category = "unit";
+  current_test_kernel.product = "kerneltest";
+  current_test_kernel.test = "performance_counters_kernel_events";
+  current_test_kernel.name = "sleep_and_touch";
+  static const parameters<result<size_t>, parameters<size_t>, hooks::performance_counters_parameters> table[] = {
+    {size_t(1) << 20, {size_t(1) << 20}, {}}, {size_t(4) << 20, {size_t(4) << 20}, {}},
+  };
+  auto permuter(st_permute_parameters(table, hooks::performance_counters()));
+  auto results = permuter(sleep_and_touch);
+  bool ok = permuter.check(results, pretty_print_failure(permuter), pretty_print_success(permuter));
+  for(size_t idx = 0; idx < results.size(); idx++)
+  {
+    hooks::performance_counts counts;
+    if(!permuter.performance_counts(idx, counts))
+    {
+      std::printf("permutation %zu was not counted\n", idx);
+      ok = false;
+    }
+    // Nothing is counted on platforms without counters
+    else if(counts.source != hooks::performance_counts::source_type::none && (counts.page_faults == 0 || counts.context_switches == 0))
+    {
+      std::printf("permutation %zu counted %llu page faults and %llu context switches\n", idx, static_cast<unsigned long long>(counts.page_faults), static_cast<unsigned long long>(counts.context_switches));
+      ok = false;
+    }
+  }
+  std::printf("%s\n", ok ? "PASSED" : "FAILED");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,61 @@
+/* Tests that permutations sharing a result cache key are never reported as passed by the result cache
+*/
+
+#include "kerneltest/kerneltest.hpp"
+
+#include <atomic>
+#include <cstdio>
+
+using namespace KERNELTEST_V1_NAMESPACE;
+
+static std::atomic<int> calls{0};
+
+// Fails the first time it is called, like a flaky kernel
+static result<int> flaky(int a, int b)
+{
+  return (calls++ == 0) ? a : a / b;
+}
+
+int main()
+{
+  current_test_kernel.category = "unit";
+  current_test_kernel.product = "kerneltest";
+  current_test_kernel.test = "result_cache_collisions";
+  current_test_kernel.name = "flaky";
+  const filesystem::path path(filesystem::temp_directory_path() / "kerneltest_result_cache_collisions.txt");
+  filesystem::remove(path);
+  bool ok = true;
+  {
+    // Two rows with the same parameters and expected outcome, so the same key
+    static const parameters<result<int>, parameters<int, int>> table[] = {{3, {9, 3}}, {3, {9, 3}}, {2, {4, 2}}};
+    auto permuter(st_permute_parameters(table));
+    permuter.options().result_cache_path = path;
+    for(int run = 0; run < 2; run++)
+    {
+      calls = 0;
+      auto results = permuter(flaky);
+      permuter.check(results, pretty_print_failure(permuter));
+      // Only the row with a key of its own can be skipped by the second run
+      if(calls != 3 - run)
+      {
+        std::printf("FAILED: run %d called the kernel %d times\n", run, calls.load());
+        ok = false;
+      }
+    }
+  }
+  {
+    // A failure of a key overrides a pass of it in the same run, whatever the order
+    result_cache cache(path);
+    std::vector<char> passed;
+    cache.record("collisions", {1, 1, 2, 2}, 7, {0, 1, 1, 0});
+    if(cache.lookup("collisions", {1, 2}, 7, passed))
+    {
+      std::printf("FAILED: a key which failed was recorded as passed\n");
+      ok = false;
+    }
+  }
+  filesystem::remove(path);
+  filesystem::remove(path.string() + ".lock");
+  std::printf("%s\n", ok ? "PASSED" : "FAILED");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,79 @@
+/* Tests that the summary returned by run_and_check() counts which permutations ran, passed and failed,
+keeping the recorded outcomes of only those which failed
+*/
+
+#include "kerneltest/kerneltest.hpp"
+
+#include <cstdio>
+
+using namespace KERNELTEST_V1_NAMESPACE;
+
+static result<int> divide(int a, int b)
+{
+  return a / b;
+}
+
+int main()
+{
+  current_test_kernel.category = "unit";
+  current_test_kernel.product = "kerneltest";
+  current_test_kernel.test = "run_and_check_summary";
+  current_test_kernel.name = "divide";
+  // The second and fifth permutations fail
+  static const parameters<result<int>, parameters<int, int>> table[] = {
+    {5, {10, 2}}, {4, {9, 3}}, {100, {2000, 20}}, {3, {9, 3}}, {make_error_code(std::errc::invalid_argument), {7, 1}}, {2, {4, 2}},
+  };
+  bool ok = true;
+  auto check = [&](const auto &permuter) {
+    size_t failures = 0, passes = 0;
+    const check_summary summary(permuter.run_and_check(divide,
+                                                       [&](size_t, const auto &, const auto &) {
+                                                         ++failures;
+                                                         return true;
+                                                       },
+                                                       [&](size_t, const auto &, const auto &) {
+                                                         ++passes;
+                                                         return true;
+                                                       }));
+    if(summary.size() != 6 || summary.ran_count() != 6 || summary.passed_count() != 4 || summary.failed_count() != 2 || failures != 2 || passes != 4)
+    {
+      std::printf("%zu of %zu permutations ran, %zu passed and %zu failed\n", summary.ran_count(), summary.size(), summary.passed_count(), summary.failed_count());
+      ok = false;
+    }
+    // Every callback returned true, so the summary is ok despite the failures
+    if(summary.all_passed() || !summary.ok())
+    {
+      std::printf("summary says all passed %d and ok %d\n", summary.all_passed(), summary.ok());
+      ok = false;
+    }
+    for(size_t idx = 0; idx < summary.size(); idx++)
+    {
+      const bool fails = (idx == 1 || idx == 4);
+      if(!summary.ran(idx) || summary.passed(idx) == fails || (summary.failure(idx) != nullptr) != fails)
+      {
+        std::printf("permutation %zu is summarised wrongly\n", idx);
+        ok = false;
+      }
+    }
+    if(summary.failure(1) == nullptr || !summary.failure(1)->has_value() || summary.failure(1)->description() != "3")
+    {
+      std::printf("the outcome of the second permutation was not recorded\n");
+      ok = false;
+    }
+    if(summary.failure(4) == nullptr || !summary.failure(4)->has_value() || summary.failure(4)->description() != "7")
+    {
+      std::printf("the outcome of the fifth permutation was not recorded\n");
+      ok = false;
+    }
+    // A callback returning false makes the summary not ok
+    if(permuter.run_and_check(divide, [](size_t, const auto &, const auto &) { return false; }).ok())
+    {
+      std::printf("summary is ok despite a callback returning false\n");
+      ok = false;
+    }
+  };
+  check(st_permute_parameters(table));
+  check(mt_permute_parameters(table));
+  std::printf("%s\n", ok ? "PASSED" : "FAILED");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,78 @@
+/* Tests that with permuter_options::recover_signals, a permutation raising a fatal signal in process is
+recorded as failed, and the permutations after it still execute
+*/
+
+#include "kerneltest/kerneltest.hpp"
+
+#include <cstdio>
+#include <vector>
+
+using namespace KERNELTEST_V1_NAMESPACE;
+
+static result<int> divide(int a, int b)
+{
+  if(a < 0)
+  {
+    volatile int *p = nullptr;
+    *p = 1;
+  }
+  return a / b;
+}
+
+int main()
+{
+#ifdef _WIN32
+  std::printf("PASSED\n");
+  return 0;
+#else
+  current_test_kernel.category = "unit";
+  current_test_kernel.product = "kerneltest";
+  current_test_kernel.test = "signal_recovery";
+  current_test_kernel.name = "divide";
+  // The hook crashes during setup if its parameter is negative
+  static const parameters<result<int>, parameters<int, int>, hooks::custom_parameters<int>> table[] = {
+    {5, {10, 2}, {0}}, {make_error_code(kerneltest_errc::kernel_signal_thrown), {-1, 3}, {0}}, {3, {9, 3}, {0}}, {make_error_code(kerneltest_errc::setup_signal_thrown), {4, 2}, {-1}}, {1, {-2, 1}, {0}}, {2, {4, 2}, {0}},
+  };
+  auto hook = [] {
+    return hooks::custom(
+    [](auto &, auto &, size_t, int v) {
+      if(v < 0)
+      {
+        volatile int *p = nullptr;
+        *p = 2;
+      }
+      return 0;
+    },
+    [](int) {}, "crashing setup");
+  };
+  bool ok = true;
+  auto check = [&](const auto &permuter, const auto &results) {
+    // The permutations expecting their crashes pass, the one not expecting it fails
+    std::vector<size_t> failed;
+    permuter.check(results, [&](size_t idx, const auto &, const auto &) {
+      failed.push_back(idx);
+      return false;
+    }, [](size_t, const auto &, const auto &) { return true; }, [&](size_t idx, const auto &) {
+      failed.push_back(idx);
+      return false;
+    });
+    if(failed != std::vector<size_t>{4})
+    {
+      std::printf("%zu permutations failed, should be just the fifth\n", failed.size());
+      ok = false;
+    }
+  };
+  // Recovering more than once checks the handlers are reinstalled each time
+  for(int n = 0; n < 2; n++)
+  {
+    auto st(st_permute_parameters(table, hook()));
+    st.options().recover_signals = true;
+    check(st, st(divide));
+    auto mt(mt_permute_parameters(table, hook()));
+    mt.options().recover_signals = true;
+    check(mt, mt(divide));
+  }
+  std::printf("%s\n", ok ? "PASSED" : "FAILED");
+  return ok ? 0 : 1;
+#endif
+}
@@ -0,0 +1,55 @@
+/* Tests that permutations which hang in their kernel or in the setting up of a hook fail with the
+timeout of where they were, both when they are waited for and when they are abandoned
+*/
+
+#include "kerneltest/kerneltest.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+using namespace KERNELTEST_V1_NAMESPACE;
+
+// Hangs for -a milliseconds if a is negative
+static result<int> divide(int a, int b)
+{
+  if(a < 0)
+    std::this_thread::sleep_for(std::chrono::milliseconds(-a));
+  return a / b;
+}
+
+int main()
+{
+  current_test_kernel.category = "unit";
+  current_test_kernel.product = "kerneltest";
+  current_test_kernel.test = "timeout";
+  current_test_kernel.name = "divide";
+  // The hook hangs during setup for as many milliseconds as its parameter
+  static const parameters<result<int>, parameters<int, int>, hooks::custom_parameters<int>> table[] = {
+    {5, {10, 2}, {0}}, {make_error_code(kerneltest_errc::kernel_timed_out), {-1500, 1}, {0}}, {make_error_code(kerneltest_errc::setup_timed_out), {4, 2}, {1500}}, {7, {7, 1}, {0}},
+  };
+  auto permuter(mt_permute_parameters(table, hooks::custom(
+                                             [](auto &, auto &, size_t, int ms) {
+                                               std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+                                               return 0;
+                                             },
+                                             [](int) {}, "hanging setup")));
+  permuter.options().workers = 2;
+  permuter.options().timeout = std::chrono::milliseconds(200);
+  bool ok = permuter.check(permuter(divide), pretty_print_failure(permuter));
+  // Abandoning the hanging permutations returns before they finish
+  permuter.options().abandon_timed_out = true;
+  const auto begin = std::chrono::steady_clock::now();
+  if(!permuter.check(permuter(divide), pretty_print_failure(permuter)))
+    ok = false;
+  const auto took = std::chrono::steady_clock::now() - begin;
+  if(took >= std::chrono::milliseconds(1500))
+  {
+    std::printf("abandoning the permutations which timed out took %lld ms\n", static_cast<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(took).count()));
+    ok = false;
+  }
+  // The abandoned threads refer to the permuter, so must finish before it is destroyed
+  std::this_thread::sleep_for(std::chrono::milliseconds(2000));
+  std::printf("%s\n", ok ? "PASSED" : "FAILED");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,82 @@
+/* Tests the parsing of cpu lists for the worker affinity, and that workers are pinned to the cpus given
+while the calling thread is left as it was found
+*/
+
+#include "kerneltest/kerneltest.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace KERNELTEST_V1_NAMESPACE;
+
+static result<int> divide(int a, int b)
+{
+  return a / b;
+}
+
+int main()
+{
+  current_test_kernel.category = "unit";
+  current_test_kernel.product = "kerneltest";
+  current_test_kernel.test = "worker_affinity";
+  current_test_kernel.name = "divide";
+  bool ok = true;
+  auto expect_cpus = [&](const char *list, const std::vector<unsigned> &shouldbe) {
+    if(detail::parse_cpu_list(list) != shouldbe)
+    {
+      std::printf("cpu list '%s' was parsed wrongly\n", list);
+      ok = false;
+    }
+  };
+  expect_cpus("0-3,8,10-11", {0, 1, 2, 3, 8, 10, 11});
+  expect_cpus("5,1,1-2", {1, 2, 5});
+  expect_cpus("x,3,", {3});
+  expect_cpus("", {});
+#ifndef _WIN32
+  setenv("KERNELTEST_PIN", "cores", 1);
+  setenv("KERNELTEST_CPUS", "2,0-1", 1);
+  const worker_affinity from_environment(worker_affinity::from_command_line());
+  if(from_environment.placement != worker_placement::cores || from_environment.node != -1 || from_environment.cpus != std::vector<unsigned>{0, 1, 2})
+  {
+    std::printf("the worker affinity was not read from the environment\n");
+    ok = false;
+  }
+  unsetenv("KERNELTEST_PIN");
+  unsetenv("KERNELTEST_CPUS");
+#endif
+#ifdef __linux__
+  // Pin every worker to the last cpu this process may run on
+  const std::vector<unsigned> before = detail::thread_affinity();
+  const unsigned cpu = before.back();
+  static const parameters<result<int>, parameters<int, int>> table[] = {
+    {5, {10, 2}}, {100, {2000, 20}}, {3, {9, 3}}, {2, {4, 2}},
+  };
+  auto permuter(mt_permute_parameters(table));
+  permuter.options().workers = 2;
+  permuter.options().affinity.placement = worker_placement::cores;
+  permuter.options().affinity.cpus = {cpu};
+  std::atomic<size_t> pinned(0);
+  auto results = permuter([&](int a, int b) {
+    if(detail::thread_affinity() == std::vector<unsigned>{cpu})
+      ++pinned;
+    return divide(a, b);
+  });
+  if(!permuter.check(results, pretty_print_failure(permuter)))
+    ok = false;
+  if(pinned != 4)
+  {
+    std::printf("%zu of 4 permutations executed on workers pinned to cpu %u\n", pinned.load(), cpu);
+    ok = false;
+  }
+  if(detail::thread_affinity() != before)
+  {
+    std::printf("the affinity of the calling thread was not restored\n");
+    ok = false;
+  }
+#else
+  (void) divide;
+#endif
+  std::printf("%s\n", ok ? "PASSED" : "FAILED");
+  return ok ? 0 : 1;
+}
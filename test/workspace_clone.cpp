@@ -0,0 +1,112 @@
+/* Tests that every way of cloning a workspace from its template gives the kernel an identical workspace
+*/
+
+#include "kerneltest/kerneltest.hpp"
+
+#include <cstdio>
+
+#ifdef _WIN32
+// Workspaces are only ever copied on Windows
+int main()
+{
+  std::printf("PASSED\n");
+  return 0;
+}
+#else
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace KERNELTEST_V1_NAMESPACE;
+
+static std::string read_file(const char *path)
+{
+  std::string ret;
+  int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+  if(fd < 0)
+    return "<missing>";
+  char buffer[4096];
+  ssize_t bytes;
+  while((bytes = ::read(fd, buffer, sizeof(buffer))) > 0)
+    ret.append(buffer, static_cast<size_t>(bytes));
+  ::close(fd);
+  return ret;
+}
+
+static bool write_file(const char *path, const std::string &contents, unsigned mode)
+{
+  int fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if(fd < 0)
+    return false;
+  bool ret = ::write(fd, contents.data(), contents.size()) == static_cast<ssize_t>(contents.size());
+  ::close(fd);
+  return ret && ::chmod(path, mode) == 0;
+}
+
+static unsigned mode_of(const char *path)
+{
+  struct stat st;
+  return (::lstat(path, &st) < 0) ? 0 : static_cast<unsigned>(st.st_mode) & 07777;
+}
+
+// A file big enough to need more than one read or clone call
+static std::string big_contents()
+{
+  std::string ret(300000, '\0');
+  for(size_t n = 0; n < ret.size(); n++)
+    ret[n] = static_cast<char>(n * 7 + n / 4096);
+  return ret;
+}
+
+static std::string original_directory;
+
+// Checks the workspace, which is the working directory, matches the template
+static result<int> kernel(int idx)
+{
+  char cwd[4096];
+  if(::getcwd(cwd, sizeof(cwd)) == nullptr || original_directory == cwd)
+    return std::errc::not_a_directory;
+  char target[64] = {0};
+  if(read_file("file.txt") != "hi\n" || read_file("run.sh") != "#!/bin/sh\n" || read_file("sub/b.txt") != "b\n" || read_file("sub/deeper/c.txt") != "c\n" || read_file("big.bin") != big_contents())
+    return std::errc::io_error;
+  if(::readlink("link", target, sizeof(target) - 1) != 8 || 0 != strcmp(target, "file.txt"))
+    return std::errc::bad_message;
+  if(mode_of("file.txt") != 0644 || mode_of("run.sh") != 0755 || mode_of("sub") != 0755 || mode_of("sub/deeper") != 0700)
+    return std::errc::permission_denied;
+  return idx;
+}
+
+int main()
+{
+  current_test_kernel.category = "unit";
+  current_test_kernel.product = "workspace_clone";
+  current_test_kernel.test = "clone";
+  current_test_kernel.name = "kernel";
+  const filesystem::path home(filesystem::temp_directory_path() / ("kerneltest_workspace_clone_" + std::to_string(::getpid())));
+  const filesystem::path workspace(home / "test" / "tests" / "clone" / "ws");
+  filesystem::create_directories(workspace / "sub" / "deeper");
+  bool ok = write_file((workspace / "file.txt").c_str(), "hi\n", 0644) && write_file((workspace / "run.sh").c_str(), "#!/bin/sh\n", 0755) && write_file((workspace / "sub" / "b.txt").c_str(), "b\n", 0644) &&
+            write_file((workspace / "sub" / "deeper" / "c.txt").c_str(), "c\n", 0644) && write_file((workspace / "big.bin").c_str(), big_contents(), 0644);
+  ok = ok && ::chmod((workspace / "sub").c_str(), 0755) == 0 && ::chmod((workspace / "sub" / "deeper").c_str(), 0700) == 0 && ::symlink("file.txt", (workspace / "link").c_str()) == 0;
+  ::setenv("KERNELTEST_WORKSPACE_CLONE_HOME", home.c_str(), 1);
+  original_directory = filesystem::current_path().string();
+  for(auto clone : {hooks::workspace_clone::copy, hooks::workspace_clone::reflink, hooks::workspace_clone::hardlink, hooks::workspace_clone::automatic})
+  {
+    if(!ok)
+      break;
+    auto permuter(st_permute_parameters(generate_parameters(3, [](size_t idx) { return parameters<result<int>, parameters<int>, hooks::filesystem_setup_parameters>(static_cast<int>(idx), {static_cast<int>(idx)}, {"ws"}); }),
+                                        hooks::filesystem_setup(current_test_kernel.test, clone)));
+    auto results = permuter(kernel);
+    if(!permuter.check(results, pretty_print_failure(permuter)))
+    {
+      std::printf("cloning with mode %d gave a different workspace\n", static_cast<int>(clone));
+      ok = false;
+    }
+  }
+  filesystem::remove_all(home);
+  std::printf("%s\n", ok ? "PASSED" : "FAILED");
+  return ok ? 0 : 1;
+}
+#endif
@@ -0,0 +1,100 @@
+/* Tests that workspaces used through their directory file descriptor can be used by many threads at once,
+each seeing only its own workspace, without the working directory of the process ever changing
+*/
+
+#include "kerneltest/kerneltest.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+#ifdef _WIN32
+// There are no directory file descriptors on Windows
+int main()
+{
+  std::printf("PASSED\n");
+  return 0;
+}
+#else
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace KERNELTEST_V1_NAMESPACE;
+
+static std::string read_file(int dirfd, const char *path)
+{
+  std::string ret;
+  int fd = ::openat(dirfd, path, O_RDONLY | O_CLOEXEC);
+  if(fd < 0)
+    return "<missing>";
+  char buffer[256];
+  ssize_t bytes;
+  while((bytes = ::read(fd, buffer, sizeof(buffer))) > 0)
+    ret.append(buffer, static_cast<size_t>(bytes));
+  ::close(fd);
+  return ret;
+}
+
+static bool write_file(int dirfd, const char *path, const std::string &contents)
+{
+  int fd = ::openat(dirfd, path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if(fd < 0)
+    return false;
+  bool ret = ::write(fd, contents.data(), contents.size()) == static_cast<ssize_t>(contents.size());
+  ::close(fd);
+  return ret;
+}
+
+static std::string original_directory;
+static std::atomic<int> executing(0), most_executing(0);
+
+// Claims the workspace for idx, waits for other permutations to do the same, then checks it is still its own
+static result<int> kernel(int idx)
+{
+  const int dirfd = current_test_kernel.working_directory_fd;
+  const int now = ++executing;
+  for(int most = most_executing; now > most && !most_executing.compare_exchange_weak(most, now);)
+    ;
+  bool ok = dirfd >= 0 && read_file(dirfd, "file.txt") == "hi\n" && read_file(dirfd, "mine.txt") == "<missing>" && write_file(dirfd, "mine.txt", std::to_string(idx));
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  ok = ok && read_file(dirfd, "mine.txt") == std::to_string(idx) && filesystem::current_path().string() == original_directory;
+  --executing;
+  if(!ok)
+    return std::errc::io_error;
+  return idx;
+}
+
+int main()
+{
+  current_test_kernel.category = "unit";
+  current_test_kernel.product = "workspace_directory_fd";
+  current_test_kernel.test = "directory_fd";
+  current_test_kernel.name = "kernel";
+  const filesystem::path home(filesystem::temp_directory_path() / ("kerneltest_workspace_directory_fd_" + std::to_string(::getpid())));
+  const filesystem::path workspace(home / "test" / "tests" / "directory_fd" / "ws");
+  filesystem::create_directories(workspace);
+  bool ok = write_file(AT_FDCWD, (workspace / "file.txt").c_str(), "hi\n");
+  ::setenv("KERNELTEST_WORKSPACE_DIRECTORY_FD_HOME", home.c_str(), 1);
+  original_directory = filesystem::current_path().string();
+  if(ok)
+  {
+    auto permuter(mt_permute_parameters(generate_parameters(8, [](size_t idx) { return parameters<result<int>, parameters<int>, hooks::filesystem_setup_parameters>(static_cast<int>(idx), {static_cast<int>(idx)}, {"ws"}); }),
+                                        hooks::filesystem_setup(current_test_kernel.test, hooks::workspace_clone::automatic, hooks::workspace_mode::directory_fd)));
+    permuter.options().workers = 2;
+    permuter.options().chunk = 1;
+    auto results = permuter(kernel);
+    ok = permuter.check(results, pretty_print_failure(permuter));
+    if(most_executing < 2)
+    {
+      std::printf("permutations never used their workspaces at once\n");
+      ok = false;
+    }
+  }
+  filesystem::remove_all(home);
+  std::printf("%s\n", ok ? "PASSED" : "FAILED");
+  return ok ? 0 : 1;
+}
+#endif
@@ -0,0 +1,99 @@
+/* Tests that the workspaces torn down during a process are all deleted by the time it exits, and that
+the trash directory they were renamed into is removed with them
+*/
+
+#include "kerneltest/kerneltest.hpp"
+
+#include <cstdio>
+
+#ifdef _WIN32
+// Deletion at exit is tested on POSIX only, as it needs fork() and exec()
+int main()
+{
+  std::printf("PASSED\n");
+  return 0;
+}
+#else
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace KERNELTEST_V1_NAMESPACE;
+
+static bool write_file(const char *path, const char *contents)
+{
+  int fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if(fd < 0)
+    return false;
+  bool ret = ::write(fd, contents, strlen(contents)) == static_cast<ssize_t>(strlen(contents));
+  ::close(fd);
+  return ret;
+}
+
+static result<int> kernel(int idx)
+{
+  return (::access("sub/file99.txt", F_OK) == 0) ? idx : -1;
+}
+
+// Executes permutations whose workspaces are left to the reaper from within run, then exits
+static int run_and_exit(const filesystem::path &run)
+{
+  filesystem::current_path(run);
+  auto permuter(mt_permute_parameters(generate_parameters(20, [](size_t idx) { return parameters<result<int>, parameters<int>, hooks::filesystem_setup_parameters>(static_cast<int>(idx), {static_cast<int>(idx)}, {"ws"}); }),
+                                      hooks::filesystem_setup(current_test_kernel.test)));
+  permuter.options().workers = 2;
+  bool ok = permuter.check(permuter(kernel), pretty_print_failure(permuter));
+  // The workspaces were renamed into the trash rather than deleted before teardown returned
+  if(!filesystem::exists(run / ("kerneltest_trash_" + std::to_string(::getpid()))))
+  {
+    std::printf("no workspace was left to the reaper\n");
+    ok = false;
+  }
+  // Returning from main() runs the destructors of statics, including the reaper
+  return ok ? 0 : 1;
+}
+
+int main(int argc, char *argv[])
+{
+  current_test_kernel.category = "unit";
+  current_test_kernel.product = "workspace_reaper";
+  current_test_kernel.test = "reaper";
+  current_test_kernel.name = "kernel";
+  const filesystem::path home(filesystem::temp_directory_path() / ("kerneltest_workspace_reaper_" + std::to_string(::getpid())));
+  const filesystem::path workspace(home / "test" / "tests" / "reaper" / "ws");
+  const filesystem::path run(home / "run");
+  // Forked children don't wait for the reaper, so the child executing the permutations is this program executed afresh
+  if(argc > 1)
+    return run_and_exit(argv[1]);
+  filesystem::create_directories(workspace / "sub");
+  filesystem::create_directories(run);
+  bool ok = true;
+  for(int n = 0; n < 100; n++)
+    ok = ok && write_file((workspace / "sub" / ("file" + std::to_string(n) + ".txt")).c_str(), "contents\n");
+  ::setenv("KERNELTEST_WORKSPACE_REAPER_HOME", home.c_str(), 1);
+  if(ok)
+  {
+    std::fflush(stdout);
+    const pid_t child = ::fork();
+    if(child == 0)
+    {
+      ::execl(argv[0], argv[0], run.c_str(), static_cast<char *>(nullptr));
+      ::_exit(127);
+    }
+    int status = 0;
+    ok = child > 0 && ::waitpid(child, &status, 0) == child && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    // Nothing is left where the workspaces were made
+    if(ok && !filesystem::is_empty(run))
+    {
+      for(const auto &i : filesystem::directory_iterator(run))
+        std::printf("%s was left behind\n", i.path().c_str());
+      ok = false;
+    }
+  }
+  filesystem::remove_all(home);
+  std::printf("%s\n", ok ? "PASSED" : "FAILED");
+  return ok ? 0 : 1;
+}
+#endif
@@ -0,0 +1,131 @@
+/* Tests that a recycled workspace is restored to its template whatever the kernel did to it
+*/
+
+#include "kerneltest/kerneltest.hpp"
+
+#include <cstdio>
+
+#ifdef _WIN32
+// Workspaces are never recycled on Windows
+int main()
+{
+  std::printf("PASSED\n");
+  return 0;
+}
+#else
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace KERNELTEST_V1_NAMESPACE;
+
+static std::string read_file(int dirfd, const char *path)
+{
+  std::string ret;
+  int fd = ::openat(dirfd, path, O_RDONLY | O_CLOEXEC);
+  if(fd < 0)
+    return "<missing>";
+  char buffer[256];
+  ssize_t bytes;
+  while((bytes = ::read(fd, buffer, sizeof(buffer))) > 0)
+    ret.append(buffer, static_cast<size_t>(bytes));
+  ::close(fd);
+  return ret;
+}
+
+static bool write_file(int dirfd, const char *path, const char *contents)
+{
+  int fd = ::openat(dirfd, path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if(fd < 0)
+    return false;
+  bool ret = ::write(fd, contents, strlen(contents)) == static_cast<ssize_t>(strlen(contents));
+  ::close(fd);
+  return ret;
+}
+
+static unsigned mode_of(int dirfd, const char *path)
+{
+  struct stat st;
+  return (::fstatat(dirfd, path, &st, AT_SYMLINK_NOFOLLOW) < 0) ? 0 : static_cast<unsigned>(st.st_mode) & 07777;
+}
+
+// The inode of an item the kernel never replaces, which is the same in every permutation if the workspace is recycled
+static ino_t kept_inode;
+
+// Checks the workspace matches the template, then changes it as idx says
+static result<int> kernel(int idx)
+{
+  const int dirfd = current_test_kernel.working_directory_fd;
+  char target[64] = {0};
+  struct stat st;
+  if(read_file(dirfd, "file.txt") != "hi\n" || read_file(dirfd, "readonly/a.txt") != "a\n" || read_file(dirfd, "sub/b.txt") != "b\n")
+    return std::errc::io_error;
+  if(::readlinkat(dirfd, "link", target, sizeof(target) - 1) != 8 || 0 != strcmp(target, "file.txt"))
+    return std::errc::not_a_directory;
+  if(::faccessat(dirfd, "added.txt", F_OK, 0) == 0 || ::faccessat(dirfd, "extra", F_OK, 0) == 0)
+    return std::errc::file_exists;
+  if(mode_of(dirfd, "readonly") != 0555 || mode_of(dirfd, "sub") != 0755 || mode_of(dirfd, "file.txt") != 0644)
+    return std::errc::permission_denied;
+  if(::fstatat(dirfd, "sub/b.txt", &st, 0) < 0 || (kept_inode != 0 && st.st_ino != kept_inode))
+    return std::errc::no_such_file_or_directory;
+  kept_inode = st.st_ino;
+  bool ok = true;
+  switch(idx % 7)
+  {
+  case 0:  // Modify a file
+    ok = write_file(dirfd, "file.txt", "ho\n");
+    break;
+  case 1:  // Delete a file
+    ok = ::unlinkat(dirfd, "file.txt", 0) == 0;
+    break;
+  case 2:  // Add a file and a directory
+    ok = write_file(dirfd, "added.txt", "added\n") && ::mkdirat(dirfd, "extra", 0755) == 0 && write_file(dirfd, "extra/c.txt", "c\n");
+    break;
+  case 3:  // Replace a symlink with one to elsewhere
+    ok = ::unlinkat(dirfd, "link", 0) == 0 && ::symlinkat("sub", dirfd, "link") == 0;
+    break;
+  case 4:  // Change the mode of a directory and a file
+    ok = ::fchmodat(dirfd, "sub", 0700, 0) == 0 && ::fchmodat(dirfd, "file.txt", 0600, 0) == 0;
+    break;
+  case 5:  // Delete a file inside a read only directory
+    ok = ::fchmodat(dirfd, "readonly", 0755, 0) == 0 && ::unlinkat(dirfd, "readonly/a.txt", 0) == 0;
+    break;
+  case 6:  // Make a directory unsearchable
+    ok = ::fchmodat(dirfd, "readonly", 0, 0) == 0;
+    break;
+  }
+  if(!ok)
+    return std::errc::operation_not_permitted;
+  return idx;
+}
+
+int main()
+{
+  current_test_kernel.category = "unit";
+  current_test_kernel.product = "workspace_recycle";
+  current_test_kernel.test = "recycle";
+  current_test_kernel.name = "kernel";
+  // Make a template with a read only directory inside a product home of its own
+  const filesystem::path home(filesystem::temp_directory_path() / ("kerneltest_workspace_recycle_" + std::to_string(::getpid())));
+  const filesystem::path workspace(home / "test" / "tests" / "recycle" / "ws");
+  filesystem::create_directories(workspace / "readonly");
+  filesystem::create_directories(workspace / "sub");
+  bool ok = write_file(AT_FDCWD, (workspace / "file.txt").c_str(), "hi\n") && write_file(AT_FDCWD, (workspace / "readonly" / "a.txt").c_str(), "a\n") && write_file(AT_FDCWD, (workspace / "sub" / "b.txt").c_str(), "b\n");
+  ok = ok && ::chmod((workspace / "file.txt").c_str(), 0644) == 0 && ::chmod((workspace / "sub").c_str(), 0755) == 0 && ::chmod((workspace / "readonly").c_str(), 0555) == 0;
+  ok = ok && ::symlink("file.txt", (workspace / "link").c_str()) == 0;
+  ::setenv("KERNELTEST_WORKSPACE_RECYCLE_HOME", home.c_str(), 1);
+  if(ok)
+  {
+    auto permuter(st_permute_parameters(generate_parameters(21, [](size_t idx) { return parameters<result<int>, parameters<int>, hooks::filesystem_setup_parameters>(static_cast<int>(idx), {static_cast<int>(idx)}, {"ws"}); }),
+                                        hooks::filesystem_setup(current_test_kernel.test, hooks::workspace_clone::automatic, hooks::workspace_mode::directory_fd, hooks::workspace_teardown::recycle)));
+    auto results = permuter(kernel);
+    ok = permuter.check(results, pretty_print_failure(permuter));
+  }
+  ::chmod((workspace / "readonly").c_str(), 0755);
+  filesystem::remove_all(home);
+  std::printf("%s\n", ok ? "PASSED" : "FAILED");
+  return ok ? 0 : 1;
+}
+#endif